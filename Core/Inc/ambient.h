@@ -0,0 +1,53 @@
+/*
+ * ambient.h
+ *
+ *  Ambient light on ADC1 channel 3 (PA3) and automatic display brightness.
+ *
+ *  TIM5 CH1 (PWM, no output) triggers one conversion every 10 ms and DMA
+ *  writes it into a circular buffer, so acquisition takes no CPU time.
+ *  Every half buffer (32 samples, 320 ms) is summed into one 16-bit
+ *  reading (oversampling: 12 bits + 4 bits from averaging). An IIR
+ *  low-pass with hysteresis smooths it, and a piecewise-linear curve
+ *  maps the reading to a brightness level that brightness.c fades to.
+ */
+
+#ifndef INC_AMBIENT_H_
+#define INC_AMBIENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AMBIENT_SAMPLES      64U    /* DMA ring, two halves of 32 conversions */
+#define AMBIENT_FULL_SCALE   65535U /* Reading for VDDA on PA3 */
+
+/* y += (x - y) / 2^shift per reading: time constant about 2.5 s */
+#define AMBIENT_IIR_SHIFT    3U
+
+/* The level is only recomputed when the filtered reading moves away from
+   the last applied one by more than 1/2^shift of it, and at least by MIN */
+#define AMBIENT_HYST_SHIFT   4U
+#define AMBIENT_HYST_MIN     128U
+
+#define AMBIENT_FADE_MS      1500U  /* Fade time to a new level */
+#define AMBIENT_MAX_POINTS   8U
+
+/* Curve point: filtered reading -> brightness level (0..BRIGHT_LEVEL_MAX).
+   Points go in increasing 'reading' order; outside them the end levels hold. */
+typedef struct
+{
+  uint16_t reading;
+  uint16_t level;
+} AMBIENT_Point_t;
+
+void AMBIENT_Start(void);
+/* Main loop: filters new readings and adjusts brightness (non-blocking) */
+void AMBIENT_Process(void);
+/* Filtered reading, 0..AMBIENT_FULL_SCALE */
+uint16_t AMBIENT_GetReading(void);
+
+bool AMBIENT_SetCurve(const AMBIENT_Point_t* points, uint8_t count);
+/* Auto off: AMBIENT_Process() keeps filtering but leaves brightness alone */
+void AMBIENT_SetAuto(bool on);
+bool AMBIENT_IsAuto(void);
+
+#endif /* INC_AMBIENT_H_ */
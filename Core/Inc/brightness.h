@@ -0,0 +1,82 @@
+/*
+ * brightness.h
+ *
+ *  Display brightness (TIM1 CH1 PWM) and non-blocking brightness effects.
+ *
+ *  Brightness is set in BRIGHT_LEVELS perceptually even steps (CIE 1931
+ *  lightness), mapped at compile time to luminance and at run time to
+ *  TIM1 counts (200 ns, 1250 per 4 kHz PWM period) with 1/8-count
+ *  resolution. The fraction is spread over PWM periods by first-order
+ *  sigma-delta, so the lowest levels give less than one count on average
+ *  without any step.
+ *
+ *  The TIM1 update event requests DMA2_Stream5, which writes the next
+ *  value into the (preloaded) CCR1 on every PWM period. While no effect
+ *  runs, circular DMA plays the 8-period dither pattern of the current
+ *  level. An effect is precomputed into a table of levels; the DMA half
+ *  and complete interrupts (every 8 ms) run the sigma-delta over the next
+ *  32 PWM periods, so the dithering never slows down with the effect.
+ */
+
+#ifndef INC_BRIGHTNESS_H_
+#define INC_BRIGHTNESS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BRIGHT_LEVELS       1024U
+#define BRIGHT_LEVEL_MAX    (BRIGHT_LEVELS - 1U)
+
+/* Sub-count resolution: 2^bits PWM periods per dither pattern.
+   3 bits = 2 ms at 4 kHz; the sparsest pattern (1/8) still pulses at 500 Hz,
+   and only on top of a whole count, where it is 1/8 count deep */
+#define BRIGHT_DITHER_BITS  3U
+#define BRIGHT_DITHER_LEN   (1U << BRIGHT_DITHER_BITS)
+
+/* Samples in one effect. The step length is chosen per effect:
+   ceil(total / BRIGHT_WAVE_LEN) ms, at most BRIGHT_MAX_STEP_MS,
+   so an effect can last up to about 65 s */
+#define BRIGHT_WAVE_LEN     256U
+#define BRIGHT_MAX_STEP_MS  256U
+
+/* Called from the DMA interrupt once the last level of an effect is on
+   (at most 16 ms after its time) */
+typedef void (*BRIGHT_Callback_t)(void);
+
+/* One leg of a sequence: move to 'level' (0..BRIGHT_LEVEL_MAX) linearly
+   over 'ms'. ms = 0 jumps to it. */
+typedef struct
+{
+  uint16_t level;
+  uint32_t ms;
+} BRIGHT_Step_t;
+
+/* Immediate brightness; any running effect is stopped */
+void BRIGHT_SetLevel(uint16_t level);
+void SetPWMPercentGamma(uint8_t percent);   /* Level = percent of BRIGHT_LEVEL_MAX */
+
+/* Raw CCR1 (0..1250) / duty, no gamma and no dithering */
+void SetPWMValue(uint16_t value);
+void SetPWMPercent(uint8_t percent);
+
+/* Effects. They start from the current level and return false if the
+   effect would be longer than BRIGHT_WAVE_LEN * BRIGHT_MAX_STEP_MS or the
+   DMA could not be started. Starting one stops the previous one without
+   calling its callback. */
+bool BRIGHT_Sequence(const BRIGHT_Step_t* steps, uint8_t count, BRIGHT_Callback_t done);
+bool BRIGHT_Fade(uint16_t level, uint32_t ms, BRIGHT_Callback_t done);
+/* 'count' times: 'level' for onMs, then back to the current level for offMs */
+bool BRIGHT_Flash(uint16_t level, uint32_t onMs, uint32_t offMs, uint8_t count, BRIGHT_Callback_t done);
+/* Endless low -> high -> low, one cycle per periodMs, until stopped */
+bool BRIGHT_Breathe(uint16_t low, uint16_t high, uint32_t periodMs);
+
+/* Stops the effect and keeps the level it had reached */
+void BRIGHT_Stop(void);
+bool BRIGHT_IsBusy(void);
+/* Current level, also while an effect runs (up to 8 ms behind) */
+uint16_t BRIGHT_GetLevel(void);
+
+/* Demo: dim, full brightness, back down (about 10 s), non-blocking */
+void FadeEffect(void);
+
+#endif /* INC_BRIGHTNESS_H_ */
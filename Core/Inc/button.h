@@ -5,6 +5,7 @@
 
 #include "stm32f4xx_hal.h"  // Dostosuj do swojej serii STM32
 #include <stdbool.h>
+#include "input.h"
 
 // Stan przycisku
 typedef enum {
@@ -12,9 +13,6 @@ typedef enum {
     BUTTON_PRESSED      // Przycisk naciśnięty
 } ButtonState;
 
-// Deklaracja funkcji obsługi przerwania enkodera
-void Encoder_HandleInterrupt(int8_t direction);
-
 // Typ funkcji callback dla przycisków
 typedef void (*ButtonCallback)(void);
 
@@ -59,9 +57,17 @@ void Button_RegisterHoldCallback(uint8_t buttonIndex, ButtonCallback cb);
 void Button_RegisterRepeatCallback(uint8_t buttonIndex, ButtonCallback cb);
 void Button_RegisterDoubleClickCallback(uint8_t buttonIndex, ButtonCallback cb);
 
-// Funkcja przetwarzająca stany przycisków
+// Debounce i wykrywanie kliknięć, co 10 ms z przerwania TIM5; wynik to
+// zdarzenia w kolejce input.h, callbacki nie są tu wywoływane
 void Button_Process(void);
 
+// Kontekst główny, zadanie planisty co 10 ms: SHT30, slider, liczniki
+// dwukropka i trybu wyświetlania
+void Button_Tick10ms(void);
+
+// Kontekst główny: wywołuje callback przycisku / enkodera dla zdarzenia
+void Button_DispatchEvent(const INPUT_Event_t* event);
+
 // Inicjalizacja przycisków (opcjonalnie)
 void Button_Init(void);
 
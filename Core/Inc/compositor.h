@@ -0,0 +1,85 @@
+/*
+ * compositor.h
+ *
+ *  Frame composition from independent layers.
+ *
+ *  Each part of the face is its own layer: seconds ring, hour rings, dots,
+ *  top display, bottom display (slider) and an overlay for menu, alarm or
+ *  effect content. A producer renders only its layer and only when its
+ *  inputs change. COMP_Commit() stacks the layers bottom to top, each
+ *  through its mask with its blend op, using 32-bit word operations; when
+ *  no layer changed it returns the previous frame without merging.
+ *
+ *  Each layer is guarded by a sequence lock instead of disabling
+ *  interrupts: the writer makes the counter odd while it renders, the
+ *  committer copies the layer and retries if the counter was odd or moved.
+ *  So a writer may be an interrupt, and a frame never carries half of a
+ *  slider step or half of a face update.
+ *
+ *  Rules: one writer per layer; COMP_Commit(), COMP_Preview() and the
+ *  layer setup functions only from the main context, which every writer
+ *  can preempt (a committer preempting a writer would spin forever).
+ */
+
+#ifndef INC_COMPOSITOR_H_
+#define INC_COMPOSITOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "display.h"
+
+/* Stacking order, bottom first */
+typedef enum
+{
+  COMP_LAYER_SECONDS = 0,   /* Seconds ring */
+  COMP_LAYER_HOURS,         /* Outer and inner hour rings */
+  COMP_LAYER_DOTS,
+  COMP_LAYER_TOP,           /* Top 7-seg display */
+  COMP_LAYER_SLIDER,        /* Bottom 7-seg display */
+  COMP_LAYER_OVERLAY,       /* Menu / alarm / effect, whole face, off by default */
+  COMP_LAYER_COUNT
+} COMP_Layer_t;
+
+/* How a layer's bits (inside its mask) combine with the layers below */
+typedef enum
+{
+  COMP_BLEND_REPLACE = 0,   /* below = layer */
+  COMP_BLEND_OR,            /* below | layer */
+  COMP_BLEND_ANDNOT,        /* below & ~layer: layer bits blank the ones below */
+  COMP_BLEND_XOR            /* below ^ layer: layer bits invert the ones below */
+} COMP_Blend_t;
+
+typedef struct
+{
+  uint32_t commits;
+  uint32_t merges;          /* Commits that had to stack the layers again */
+  uint32_t layerCopies;     /* Changed layers copied out */
+  uint32_t retries;         /* Layer copies repeated because a writer was active */
+} COMP_Stats_t;
+
+/* Clears all layers; every layer owns its own field(s) with REPLACE, the
+   overlay owns the whole face with XOR and is disabled */
+void COMP_Init(void);
+
+/* Layer setup (main context) */
+void COMP_SetBlend(COMP_Layer_t layer, COMP_Blend_t blend);
+void COMP_SetMask(COMP_Layer_t layer, const DisplayFrame_t* mask);
+void COMP_SetEnabled(COMP_Layer_t layer, bool enabled);
+
+/* Writer: the returned layer keeps its previous content; bits outside the
+   layer mask are ignored by the commit. Every Begin needs its End. */
+DisplayFrame_t* COMP_BeginWrite(COMP_Layer_t layer);
+void COMP_EndWrite(COMP_Layer_t layer);
+
+/* Consistent copy of one layer's content */
+void COMP_ReadLayer(COMP_Layer_t layer, DisplayFrame_t* copy);
+
+/* Consistent stack of all layers; true if it differs from the last commit
+   (content or layer setup changed) */
+bool COMP_Commit(DisplayFrame_t* out);
+/* Stack with some layers replaced (NULL entries: live layer), for frames
+   rendered ahead of time; the live layers and COMP_Commit() are untouched */
+void COMP_Preview(DisplayFrame_t* out, const DisplayFrame_t* const replace[COMP_LAYER_COUNT]);
+void COMP_GetStats(COMP_Stats_t* stats);
+
+#endif /* INC_COMPOSITOR_H_ */
@@ -0,0 +1,46 @@
+/*
+ * decfmt.h
+ *
+ *  Decimal formatting straight into 7-seg glyphs, without division:
+ *  /10, /100 and /10000 are reciprocal multiplications (one UMULL each),
+ *  two digits at a time come from a digit-pair glyph table, and 64-bit
+ *  values are split by 10^8 using 32x32 partial products
+ *  (no __aeabi_uldivmod).
+ */
+
+#ifndef INC_DECFMT_H_
+#define INC_DECFMT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Flags */
+#define DECFMT_BLANK_PAD   0x00U   /* Unused leading digits blank */
+#define DECFMT_ZERO_PAD    0x01U   /* Unused leading digits '0' */
+
+/* Exact for every uint32_t */
+static inline uint32_t DECFMT_Div10(uint32_t x)
+{
+  return (uint32_t)(((uint64_t)x * 0xCCCCCCCDULL) >> 35);
+}
+
+static inline uint32_t DECFMT_Div100(uint32_t x)
+{
+  return (uint32_t)(((uint64_t)x * 0x51EB851FULL) >> 37);
+}
+
+static inline uint32_t DECFMT_Div10000(uint32_t x)
+{
+  return (uint32_t)(((uint64_t)x * 0xD1B71759ULL) >> 45);
+}
+
+/* Two glyphs (tens, ones) for 0..99 */
+void DECFMT_Pair(uint8_t value, uint8_t* glyphs);
+
+/* 'value' right-aligned in 'width' glyphs. If it has more digits, only the
+   lowest 'width' digits are shown. Returns the number of digits written
+   (at least 1). */
+uint8_t DECFMT_U32(uint32_t value, uint8_t* glyphs, uint8_t width, uint8_t flags);
+uint8_t DECFMT_U64(uint64_t value, uint8_t* glyphs, uint8_t width, uint8_t flags);
+
+#endif /* INC_DECFMT_H_ */
@@ -12,96 +12,178 @@
 #include <stdbool.h>
 #include <string.h>
 
-/* 192-bit structure layout:
-   - 60 bits: seconds ring
-   - 12 bits: outer hours ring
-   - 12 bits: inner hours ring
-   - 2 bits: dots
-   - 10 bits: filler
-   - 48 bits: top 7-seg display
-   - 48 bits: bottom 7-seg display
+/* 192-bit chain layout (bit 0 is shifted out last):
+   - bits   0..59 : seconds ring
+   - bits  60..71 : outer hours ring
+   - bits  72..83 : inner hours ring
+   - bits  84..85 : dots
+   - bits  86..95 : filler
+   - bits  96..143: top 7-seg display
+   - bits 144..191: bottom 7-seg display
 */
-typedef struct __attribute__((packed,aligned(1)))
+#define FRAME_OFS_SECONDS_RING     0U
+#define FRAME_LEN_SECONDS_RING     60U
+#define FRAME_OFS_HOURS_OUTER      60U
+#define FRAME_LEN_HOURS_OUTER      12U
+#define FRAME_OFS_HOURS_INNER      72U
+#define FRAME_LEN_HOURS_INNER      12U
+#define FRAME_OFS_DOTS             84U
+#define FRAME_LEN_DOTS             2U
+#define FRAME_OFS_TOP_DISPLAY      96U
+#define FRAME_LEN_TOP_DISPLAY      48U
+#define FRAME_OFS_BOTTOM_DISPLAY   144U
+#define FRAME_LEN_BOTTOM_DISPLAY   48U
+
+#define FRAME_BITS                 192U
+#define FRAME_HALFWORDS            (FRAME_BITS / 16U)
+#define FRAME_WORDS                (FRAME_BITS / 32U)
+
+/* Halfword holding chain bit 'bit'. Halfwords are stored in wire order:
+   half[0] goes out first (bits 191..176), half[11] last (bits 15..0),
+   so SPI1 in 16-bit MSB-first mode can stream the frame as it is. */
+#define FRAME_HALF_INDEX(bit)      (FRAME_HALFWORDS - 1U - ((bit) >> 4))
+
+/* Byte of the frame holding chain bit 'bit' (halfwords are little endian) */
+#define FRAME_BYTE_INDEX(bit)      (2U * FRAME_HALF_INDEX(bit) + (((bit) >> 3) & 1U))
+
+/* Display frame in shift-register wire order, word aligned for DMA */
+typedef union
 {
-  uint64_t secondsRing       : 60;  /* Seconds ring bits */
-  uint64_t hoursRingOuter    : 12;  /* Outer hours ring */
-  uint64_t hoursRingInner    : 12;  /* Inner hours ring */
-  uint64_t dots              : 2;   /* Dot segments */
-  uint64_t filler            : 10;  /* Filler bits */
-  uint64_t topDisplay        : 48;  /* Top display segments */
-  uint64_t bottomDisplay     : 48;  /* Bottom display segments */
-} MyClockBitFields;
+  uint32_t word[FRAME_WORDS];
+  uint16_t half[FRAME_HALFWORDS];
+  uint8_t  byte[FRAME_BITS / 8U];
+} DisplayFrame_t;
 
 /*!!!!!!!! PAMIĘTAĆ O  0ULL I 1ULL GDZIE TRZEBA */
 
-/* 192-bit value represented as 12 x 16-bit parts */
-typedef struct {
-  uint16_t part[12];
-} Bits192;
+/* Writes 'width' bits of 'value' at chain bit 'offset'.
+   With constant offset/width this folds into a few halfword read-modify-writes. */
+static inline void WriteFrameBits(DisplayFrame_t* frame, uint8_t offset, uint8_t width, uint64_t value)
+{
+  while (width > 0U) {
+    uint8_t shift = offset & 15U;
+    uint8_t count = 16U - shift;
+    if (count > width) count = width;
+    uint16_t mask = (uint16_t)(((1UL << count) - 1U) << shift);
+    uint16_t* half = &frame->half[FRAME_HALF_INDEX(offset)];
+    *half = (uint16_t)((*half & ~mask) | (((uint32_t)value << shift) & mask));
+    value >>= count;
+    offset += count;
+    width -= count;
+  }
+}
+
+/* Reads 'width' bits starting at chain bit 'offset' */
+static inline uint64_t ReadFrameBits(const DisplayFrame_t* frame, uint8_t offset, uint8_t width)
+{
+  uint64_t value = 0ULL;
+  uint8_t pos = 0U;
+  while (pos < width) {
+    uint8_t bit = offset + pos;
+    uint8_t shift = bit & 15U;
+    uint8_t count = 16U - shift;
+    if (count > (uint8_t)(width - pos)) count = width - pos;
+    uint32_t chunk = ((uint32_t)frame->half[FRAME_HALF_INDEX(bit)] >> shift) & ((1UL << count) - 1U);
+    value |= (uint64_t)chunk << pos;
+    pos += count;
+  }
+  return value;
+}
+
+/* An unchanged frame is still retransmitted after this many skipped submits
+   (100 x 10 ms = 1 s), so a glitch on the chain never sticks for long */
+#define DISPLAY_FORCED_REFRESH_FRAMES  100U
+
+/* Latch pulse on SPI1_LATCH (TIM3 CH1 one-pulse): fires this long after the
+   last bit of the frame has been clocked out, and stays high this long */
+#define DISPLAY_LATCH_GUARD_US         1U
+#define DISPLAY_LATCH_WIDTH_US         1U
+
+void DISPLAY_LatchInit(void);
+void DISPLAY_ReleaseSpi(void);
+void DISPLAY_ReclaimSpi(void);
+
+/* Second-locked presentation. A frame staged before the RTC second edge is
+   shifted into the chain but not latched; the RTC wakeup interrupt latches
+   it on the edge. 'edge' is DISPLAY_EdgeCount() taken before the RTC was
+   read for rendering: if an edge has passed since, the frame is stale and
+   refused. Also refused while SPI1 is busy or another frame is staged. */
+bool DISPLAY_StageFrame(const DisplayFrame_t* frame, uint32_t edge);
+uint32_t DISPLAY_EdgeCount(void);
+/* RTC wakeup ISR, first thing: 'entryCycles' is DWT->CYCCNT at ISR entry */
+void DISPLAY_LatchStaged(uint32_t entryCycles);
+
+/* SPI1 frame pipeline counters */
+typedef struct
+{
+  uint32_t submitted;    /* Frames passed to UpdateAllDisplays() */
+  uint32_t transmitted;  /* Frames shifted out and latched */
+  uint32_t coalesced;    /* Pending frames replaced by a newer one before DMA took them */
+  uint32_t skipped;      /* Frames identical to the last one, not transmitted */
+  uint32_t bytesAvoided; /* SPI/DMA bytes saved by skipping unchanged frames */
+  uint32_t edgeLatched;  /* Staged frames latched by the second-edge interrupt */
+  uint32_t edgeLate;     /* Staged frames still shifting at the edge, latched when done */
+  uint32_t edgeMissed;   /* Second edges with no frame staged */
+  uint32_t edgeCyclesLast; /* CPU cycles from edge interrupt entry to latch pulse */
+  uint32_t edgeCyclesMax;
+} DisplayStats_t;
 
-/* Function prototypes for SPI data sending */
-void Send192_struct(const Bits192 *data);
+void DISPLAY_GetStats(DisplayStats_t* stats);
 
 /* Functions to display bits */
-void ClearClockBits(MyClockBitFields* clockBits);
-void SetSecondLedSingle(MyClockBitFields* clockBits, uint8_t second);
-void SetSecondLedAccumulating(MyClockBitFields* clockBits, uint8_t second);
-void SetSecondLedAccumulating2(MyClockBitFields* clockBits, uint8_t second);
-void SetSecondsDots(MyClockBitFields* clockBits, uint8_t second);
-void SetHourRing(MyClockBitFields* clockBits, uint8_t hour, bool outerRing, bool innerRing);
-void SetHoursRing(MyClockBitFields* clockBits, uint8_t hour);
-void SetTime7Seg_Top(MyClockBitFields* clockBits, uint8_t h, uint8_t m, uint8_t s);
-void Set7Seg_Bot3(MyClockBitFields* clockBits, uint8_t h, uint8_t m, uint8_t s);
-void UpdateAllDisplays(const MyClockBitFields* clockBits);
-void SetSecondLedEvenOdd(MyClockBitFields* clockBits, uint8_t second, uint8_t minute);
-void SetHourRingCustom(MyClockBitFields* clockBits, uint8_t outerMode, uint8_t innerMode);
-void Set7Seg_DisplayLargeNumber(MyClockBitFields* clockBits, uint64_t number);
-void SetTime7Seg_Void(MyClockBitFields* clockBits);
-
-/* Functions for PWM and brightness control */
+void ClearClockBits(DisplayFrame_t* frame);
+void SetSecondsDots(DisplayFrame_t* frame, uint8_t second);
+void SetHourRing(DisplayFrame_t* frame, uint8_t hour, bool outerRing, bool innerRing);
+void SetHoursRing(DisplayFrame_t* frame, uint8_t hour);
+void SetTime7Seg_Top(DisplayFrame_t* frame, uint8_t h, uint8_t m, uint8_t s);
+void SetTime7Seg_TopBCD(DisplayFrame_t* frame, uint32_t rtcTR);
+void Set7Seg_Bot3(DisplayFrame_t* frame, uint8_t h, uint8_t m, uint8_t s);
+void UpdateAllDisplays(const DisplayFrame_t* frame);
+void Set7Seg_DisplayLargeNumber(DisplayFrame_t* frame, uint64_t number);
+void SetTime7Seg_Void(DisplayFrame_t* frame);
+
 void DisplayScrollingText(const char* text);
-void SetPWMValue(uint16_t value);
-void SetPWMPercent(uint8_t percent);
-void SetPWMPercentGamma(uint8_t percent);
-void FadeEffect(void);
-void SetDots(MyClockBitFields* clockBits, bool dot1, bool dot2);
-
-/* 7-seg segment map and character conversion */
-static const uint8_t segmentMap[42] = {
-    0b00111111,   /* 0 */
-    0b00000110,   /* 1 */
-    0b01011011,   /* 2 */
-    0b01001111,   /* 3 */
-    0b01100110,   /* 4 */
-    0b01101101,   /* 5 */
-    0b01111101,   /* 6 */
-    0b00000111,   /* 7 */
-    0b01111111,   /* 8 */
-    0b01101111,   /* 9 */
-    0b00000000,   /* Blank (10) */
-    0b01000000,   /* Minus (11) */
-    0b01100011,   /* Degree (12) */
-    0b00111001,   /* C (13) */
-    0b01010000,   /* r (14) */
-    0b01110100,   /* h (15) */
-    0b01110001,   /* F (16) */
-    0b01110111,   /* A (17) */
-    0b01111000,   /* t (18) */
-    0b00111110,   /* U/V (19) */
-    0b01010100,   /* n (20) */
-    0b00010000,   /* i (21) */
-    0b01111001,   /* e (22) */
-    0b01011110,   /* d (23) */
-    0b01110011,   /* p (24) */
-    0b01011100,   /* o (25) */
-    0b00011100,   /* u/w/v (26) */
-    0b00111000,   /* L (27) */
-    0b01111100,   /* b (28) */
-    0b01101110,   /* y (29) */
-    0b01110110,   /* H (30) */
-    0b00011110    /* J (31) */
-};
-
-uint8_t charToSegment(char c);
+void SetDots(DisplayFrame_t* frame, bool dot1, bool dot2);
+
+/* 7-seg glyphs: table lookup, 0 for any character without a glyph */
+#define SEG_BLANK   0x00U
+#define SEG_MINUS   0x40U
+
+/* Digit glyphs, shared by segmentTable and the decimal formatter */
+#define SEG_GLYPH_0 0x3FU
+#define SEG_GLYPH_1 0x06U
+#define SEG_GLYPH_2 0x5BU
+#define SEG_GLYPH_3 0x4FU
+#define SEG_GLYPH_4 0x66U
+#define SEG_GLYPH_5 0x6DU
+#define SEG_GLYPH_6 0x7DU
+#define SEG_GLYPH_7 0x07U
+#define SEG_GLYPH_8 0x7FU
+#define SEG_GLYPH_9 0x6FU
+
+extern const uint8_t segmentTable[128];
+
+static inline uint8_t charToSegment(char c)
+{
+  uint8_t i = (uint8_t)c;
+  return (i < 128U) ? segmentTable[i] : SEG_BLANK;
+}
+
+uint64_t EncodeSegments6(const char* text);
+
+/* 7-seg displays: six digits each, digit 0 is the leftmost one.
+   The wiring order of each display is handled inside the renderer. */
+#define SEG_DIGITS  6U
+#define SEG_DP      0x80U   /* Decimal point bit of a glyph */
+
+typedef enum
+{
+  DISPLAY_TOP = 0,
+  DISPLAY_BOTTOM
+} SegDisplay_t;
+
+void Render7Seg(DisplayFrame_t* frame, SegDisplay_t disp, const uint8_t glyphs[SEG_DIGITS]);
+void Render7SegRange(DisplayFrame_t* frame, SegDisplay_t disp, uint8_t first, uint8_t count, const uint8_t* glyphs);
+void Set7SegPoint(DisplayFrame_t* frame, SegDisplay_t disp, uint8_t digit, bool on);
 
 #endif /* INC_DISPLAY_H_ */
@@ -0,0 +1,68 @@
+/*
+ * display_bcm.h
+ *
+ *  Binary code modulation (BCM) of the ring LEDs on the 192-bit chain.
+ *
+ *  With N bits of depth, bit-plane k of the LED levels is shifted out and
+ *  latched 2^k times inside a sequence of 2^N - 1 equally long frame slots.
+ *  The whole sequence sits in RAM and SPI1 DMA streams it in circular
+ *  double-buffer mode. TIM3 CH1 runs free and synchronous with SPI1,
+ *  giving one latch pulse per slot. The CPU does nothing per plane; the
+ *  DMA interrupt fires once per sequence, only to swap in a new one.
+ */
+
+#ifndef INC_DISPLAY_BCM_H_
+#define INC_DISPLAY_BCM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "display.h"
+
+#define BCM_MAX_BITS        6U
+#define BCM_MAX_SLOTS       ((1U << BCM_MAX_BITS) - 1U)
+
+/* Grey-level LEDs: the seconds ring and both hour rings (chain bits 0..83).
+   The other chain bits (dots, 7-seg) are copied unchanged from the base frame. */
+#define BCM_LEDS            FRAME_OFS_DOTS
+#define BCM_LED_SECOND(s)   (FRAME_OFS_SECONDS_RING + (s))
+#define BCM_LED_OUTER(h)    (FRAME_OFS_HOURS_OUTER + (h))
+#define BCM_LED_INNER(h)    (FRAME_OFS_HOURS_INNER + (h))
+
+/* Shortest SPI1 prescaler usable for BCM. Below it, one bit lasts fewer than
+   8 timer ticks, which leaves too little room to place the latch between
+   two SCK edges */
+#define BCM_MIN_SPI_DIV     8U
+
+/* Moves the latch pulse later (+) relative to the frame boundary,
+   in timer ticks, to compensate for the SPI DMA start latency */
+#define BCM_LATCH_PHASE_TICKS  0
+
+/* Refresh rate of a full BCM sequence in mHz:
+   PCLK2 / (192 * div * (2^bits - 1)). 'spiPrescaler' is an
+   SPI_BAUDRATEPRESCALER_x value. Returns 0 for an unusable combination.
+   E.g. at 25 MHz: div 32 -> 271 Hz @ 4 bits, 65 Hz @ 6 bits;
+                   div 8  -> 1085 Hz @ 4 bits, 258 Hz @ 6 bits */
+uint32_t BCM_RefreshRate_mHz(uint32_t spiPrescaler, uint8_t bits);
+
+/* Takes SPI1/TIM3 from the normal frame pipeline and starts streaming with
+   'bits' of depth (1..BCM_MAX_BITS). Levels start at 0 over 'base'. */
+bool BCM_Start(uint8_t bits, const DisplayFrame_t* base);
+
+/* Stops streaming and gives SPI1 back to UpdateAllDisplays(). Also due after
+   a DMA error; does nothing if the engine was not started. */
+void BCM_Stop(void);
+
+/* Started and streaming (false after a DMA error) */
+bool BCM_IsRunning(void);
+
+/* Level of one ring LED, 0 (off) .. 2^bits - 1 (full) */
+void BCM_SetLevel(uint8_t led, uint8_t level);
+void BCM_ClearLevels(void);
+
+/* Renders the levels set so far over 'base' into the idle sequence buffer.
+   The DMA switches to it at the end of the current sequence.
+   Returns false (nothing changed) if the previous commit is still being
+   switched in, i.e. less than two sequences ago; just retry on the next tick. */
+bool BCM_Commit(const DisplayFrame_t* base);
+
+#endif /* INC_DISPLAY_BCM_H_ */
@@ -12,10 +12,37 @@
 #include <stdbool.h>
 #include "rtc.h"
 #include "main.h"
+#include "nmea.h"
 
-#define GPS_DMA_BUFFER_SIZE 1024
+/* Circular RX DMA ring. Reception events come on USART1 IDLE (end of a
+   burst) and on DMA half / full, so the ring only has to cover the time
+   until the GPS task runs, not a whole polling period: 128 bytes per half
+   is over 130 ms at 9600 baud. */
+#define GPS_DMA_BUFFER_SIZE 256
+#define GPS_MAX_SYSTEMS     6   // Talkers tracked for satellites in view
+/* Time from the epoch an RMC / ZDA sentence reports to the end of that
+   sentence (ms), used without a locked PPS (pps.h). This is only the start
+   value: while the PPS is locked the parser measures the receiver's own
+   delay and uses that (GPS_RxStats_t.nmeaDelayUs). 120 ms: a u-blox at
+   9600 baud starts the burst a few tens of ms after the epoch, and RMC
+   (~70 characters) takes 73 ms. */
+#define GPS_NMEA_DELAY_MS   120
 extern uint8_t gps_dma_buffer[GPS_DMA_BUFFER_SIZE];
 
+// Reception statistics; latencies in DWT cycles (SYSCLK)
+typedef struct
+{
+    uint32_t idleEvents;     // USART1 IDLE line
+    uint32_t halfEvents;     // DMA half transfer
+    uint32_t fullEvents;     // DMA transfer complete (ring wrap)
+    uint32_t errors;         // UART errors (noise, framing, overrun, DMA)
+    uint32_t restarts;       // Reception restarted after one of them
+    uint32_t rtcUpdates;     // GPS time handed to the RTC discipline (timesync.h)
+    uint32_t latencyLast;    // Last byte of the sentence -> discipline done
+    uint32_t latencyMax;
+    uint32_t nmeaDelayUs;    // Epoch -> sentence end applied without a PPS
+} GPS_RxStats_t;
+
 // Structure holding GPS data
 typedef struct
 {
@@ -26,6 +53,9 @@ typedef struct
     uint8_t month;      // Month
     uint8_t year;       // Year (e.g., 24 for 2024)
     uint8_t satellites; // Number of satellites in use
+    uint8_t satsInView; // Satellites in view, all constellations (GSV)
+    uint8_t fixMode;    // GSA: 1 = no fix, 2 = 2D, 3 = 3D (0 = not reported)
+    uint16_t hdop;      // GSA horizontal dilution of precision, tenths
     char fix;           // GPS fix status ('A' = Active, 'V' = Void)
 } gps_data_t;
 
@@ -39,6 +69,11 @@ void ConvertUtcToLocalTime(uint8_t utcHours, uint8_t utcMinutes,
 
 // Initialize the GPS parser (e.g., clear buffers)
 void GPS_Init(void);
+// Starts (or restarts) USART1 reception into gps_dma_buffer
+HAL_StatusTypeDef GPS_StartReception(void);
+void GPS_GetRxStats(GPS_RxStats_t* stats);
+// Accepted / bad checksum / overlong sentences of one ID, e.g. NMEA_ID('R','M','C')
+bool GPS_GetNmeaStats(uint16_t id, NMEA_TypeStats_t* stats);
 
 // Get day of week for a given date
 uint8_t GetDayOfWeek(uint16_t year, uint8_t month, uint8_t day);
@@ -0,0 +1,58 @@
+/*
+ * input.h
+ *
+ *  Input events (encoder, button) from interrupts to the main context.
+ *
+ *  TIM4 (encoder edge) and TIM5 (button debounce, 10 ms) push timestamped
+ *  events into a single-producer / single-consumer ring; both run at
+ *  IRQ_PRIO_TICK, so they never preempt each other and count as one
+ *  producer. The "input" scheduler task pops them and calls the button and
+ *  encoder callbacks, so menu and slider code never runs in an interrupt.
+ *
+ *  When the ring is full the event is dropped and counted. Encoder steps
+ *  are not lost: they are carried into the next encoder event.
+ */
+
+#ifndef INC_INPUT_H_
+#define INC_INPUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define INPUT_QUEUE_LEN   32U   /* Power of two */
+
+typedef enum
+{
+  INPUT_EVT_ENCODER = 0,        /* value: steps, + clockwise */
+  INPUT_EVT_PRESS,              /* Single click, after the double-click window */
+  INPUT_EVT_RELEASE,
+  INPUT_EVT_HOLD,
+  INPUT_EVT_REPEAT,
+  INPUT_EVT_DOUBLE_CLICK
+} INPUT_EventType_t;
+
+typedef struct
+{
+  uint32_t time;                /* HAL_GetTick() when pushed */
+  uint8_t  type;                /* INPUT_EventType_t */
+  uint8_t  source;              /* Button index, 0 for the encoder */
+  int16_t  value;
+} INPUT_Event_t;
+
+typedef struct
+{
+  uint32_t pushed;
+  uint32_t dropped;             /* Button events lost to a full ring */
+  uint32_t carried;             /* Encoder events merged into a later one */
+  uint8_t  highWater;
+} INPUT_Stats_t;
+
+/* Producer side, IRQ_PRIO_TICK interrupts only */
+bool INPUT_Push(INPUT_EventType_t type, uint8_t source, int16_t value);
+/* Producer side, every 10 ms: queues carried encoder steps once there is room */
+void INPUT_Flush(void);
+/* Consumer side, main context; false when empty */
+bool INPUT_Pop(INPUT_Event_t* event);
+void INPUT_GetStats(INPUT_Stats_t* stats);
+
+#endif /* INC_INPUT_H_ */
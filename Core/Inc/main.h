@@ -25,11 +25,11 @@
 #include "stm32f4xx_hal.h"
 
 /* USER CODE BEGIN Includes */
-#include "display.h"            /* Defines MyClockBitFields and display functions */
+#include "display.h"            /* Defines DisplayFrame_t and display functions */
 
 extern SPI_HandleTypeDef hspi1; /* SPI handle */
 extern TIM_HandleTypeDef htim1; /* Timer handle */
-extern MyClockBitFields clockReg; /* Global display register */
+extern TIM_HandleTypeDef htim3; /* Latch one-pulse timer handle */
 extern RTC_TimeTypeDef sTime;       /* Global RTC time structure */
 /* USER CODE END Includes */
 
@@ -56,10 +56,27 @@ extern volatile uint8_t colon; /* Global variable for colon state */
 /* Private defines -----------------------------------------------------------*/
 #define SPI1_LATCH_Pin GPIO_PIN_6
 #define SPI1_LATCH_GPIO_Port GPIOA
+#define GPS_PPS_Pin GPIO_PIN_15
+#define GPS_PPS_GPIO_Port GPIOA
 #define ENC_SW_Pin GPIO_PIN_5
 #define ENC_SW_GPIO_Port GPIOB
 
 /* USER CODE BEGIN Private defines */
+/* Mapa priorytetów NVIC (grupa 4, bez subpriorytetów). Wartości w
+   MX_*_Init / HAL_*_MspInit i w .ioc muszą się z nią zgadzać.
+   0  RTC_WKUP, SPI1, DMA2_Stream3    zatrzask wyświetlacza na zboczu sekundy
+   1  USART1, DMA2_Stream2, TIM2      GPS: linia IDLE, RX DMA, capture PPS
+   2  I2C2, DMA1_Stream2/7, SPI2,     SHT30 i SPI2
+      DMA1_Stream3/4
+   3  TIM4, TIM5, DMA2_Stream0/5      enkoder, tick 10 ms, ADC, jasność;
+                                      jedyni producenci input.h
+   15 SysTick
+   Reszta pracy: kontekst główny (sched.h) */
+#define IRQ_PRIO_LATCH   0U
+#define IRQ_PRIO_RX      1U
+#define IRQ_PRIO_IO      2U
+#define IRQ_PRIO_TICK    3U
+
 /* USER CODE BEGIN 0 */
 void Button1_Pressed(void);
 void Button1_DoubleClicked(void);
@@ -20,6 +20,20 @@ typedef enum
 // Registers the encoder callback and resets state variables.
 void MENU_Init(void);
 void Display(void);
+// Stages the next second's frame for the RTC second edge; call after Display().
+void Display_StageNextSecond(void);
+
+// Display() render cache: a hit is a pass whose inputs (time, menu modes,
+// sensor reading, colon, slider state) were unchanged, so nothing was drawn.
+typedef struct
+{
+    uint32_t frames;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t layerRenders;  // Face layers redrawn on misses (a miss redraws only what changed)
+} DisplayRenderStats_t;
+
+void Display_GetRenderStats(DisplayRenderStats_t* stats);
 
 // Returns whether the menu is active (i.e., the user is navigating the menu).
 bool MENU_IsActive(void);
@@ -37,8 +51,8 @@ void MENU_Next(void);
 // This function is non-blocking.
 void MENU_Process(void);
 
-// Encoder callback function; 'direction' is +1 (clockwise) or -1 (counter-clockwise).
-void MENU_OnEncoderRotate(int8_t direction);
+// Encoder callback function; 'steps' > 0 clockwise, < 0 counter-clockwise (may be more than 1).
+void MENU_OnEncoderRotate(int8_t steps);
 
 // Returns the current mode (0..4) for the specified menu item.
 // This can be used in the main loop to control rings, displays, etc.
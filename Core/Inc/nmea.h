@@ -0,0 +1,115 @@
+/*
+ * nmea.h
+ *
+ *  Single-pass NMEA 0183 tokenizer working in place on a circular buffer.
+ *
+ *  Bytes are fed as they arrive (NMEA_Feed with the DMA ring and the new
+ *  range). The tokenizer keeps the XOR checksum and the field boundaries
+ *  (ring offsets, nothing is copied) while the sentence comes in; only when
+ *  "*hh" matches does it hand the sentence to the callback. A sentence is
+ *  dropped if its checksum is wrong or missing, or if it is longer than
+ *  NMEA_MAX_LEN or NMEA_MAX_FIELDS allow.
+ *
+ *  Sentences are dispatched on the 3-letter ID alone, so "$GPRMC",
+ *  "$GNRMC" and "$BDRMC" all go to the RMC handler; the talker is passed
+ *  along in the sentence. The ID is looked up once, when the address
+ *  field ends, in a small hash table.
+ *
+ *  Fields stay valid in the ring until the DMA comes round again, i.e.
+ *  for the callback as long as the reader keeps within a ring length
+ *  minus NMEA_MAX_LEN of the writer.
+ */
+
+#ifndef INC_NMEA_H_
+#define INC_NMEA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NMEA_MAX_LEN      82U   /* '$' to '\n', NMEA 0183 limit */
+#define NMEA_MAX_FIELDS   24U   /* Address field included */
+
+/* Sentence ID without the talker, 5 bits per letter: NMEA_ID('R','M','C') */
+#define NMEA_ID(a, b, c)  ((uint16_t)((((uint16_t)(a) & 0x1FU) << 10) | \
+                                      (((uint16_t)(b) & 0x1FU) << 5) | ((uint16_t)(c) & 0x1FU)))
+#define NMEA_ID_NONE      0U    /* Proprietary or malformed address */
+/* Talker as two characters, e.g. NMEA_TALKER('G','L') */
+#define NMEA_TALKER(a, b) ((uint16_t)(((uint16_t)(uint8_t)(a) << 8) | (uint8_t)(b)))
+
+#define NMEA_MAX_SENTENCES 8U   /* Registered sentence IDs */
+#define NMEA_HASH_SIZE     16U  /* ID -> entry lookup, power of two > MAX_SENTENCES */
+#define NMEA_UNREGISTERED  0xFFU
+
+typedef struct
+{
+  uint16_t start;           /* Ring offset of the first character */
+  uint8_t  len;
+} NMEA_Field_t;
+
+typedef struct
+{
+  const uint8_t* ring;
+  uint16_t ringSize;
+  uint16_t talker;          /* NMEA_TALKER(), 0 if proprietary */
+  uint16_t id;              /* NMEA_ID(), NMEA_ID_NONE if proprietary */
+  uint8_t  entry;           /* Registered entry, NMEA_UNREGISTERED if none */
+  uint16_t end;             /* Ring offset after the last checksum digit */
+  uint8_t  fieldCount;      /* field[0] is the address, e.g. "GPRMC" */
+  NMEA_Field_t field[NMEA_MAX_FIELDS];
+} NMEA_Sentence_t;
+
+typedef void (*NMEA_Handler_t)(const NMEA_Sentence_t* sentence);
+
+typedef struct
+{
+  uint32_t accepted;
+  uint32_t badChecksum;     /* Checksum wrong, missing or malformed */
+  uint32_t overlong;        /* Too many characters or fields */
+} NMEA_TypeStats_t;
+
+typedef struct
+{
+  uint16_t id;
+  NMEA_Handler_t handler;
+  NMEA_TypeStats_t stats;
+} NMEA_Entry_t;
+
+typedef struct
+{
+  /* Tokenizer state */
+  uint8_t  state;
+  uint8_t  length;          /* Characters since '$' */
+  uint8_t  checksum;        /* XOR of the characters between '$' and '*' */
+  uint8_t  received;        /* "*hh" as parsed */
+  NMEA_Sentence_t sentence;
+  /* Dispatch: hash slot -> entry + 1 (0 = empty), linear probing */
+  uint8_t  index[NMEA_HASH_SIZE];
+  uint8_t  entryCount;
+  NMEA_Entry_t entry[NMEA_MAX_SENTENCES];
+  NMEA_TypeStats_t unregistered;  /* Sentences with no handler */
+  uint32_t interrupted;     /* '$' inside a sentence: the previous one was cut */
+} NMEA_Parser_t;
+
+void NMEA_Init(NMEA_Parser_t* parser);
+/* One handler per sentence ID, for every talker (GP, GN, GL, GA, BD, ...).
+   Registering an ID again replaces its handler. False if the table is full. */
+bool NMEA_Register(NMEA_Parser_t* parser, uint16_t id, NMEA_Handler_t handler);
+/* Counters of a registered ID; false if not registered */
+bool NMEA_GetStats(const NMEA_Parser_t* parser, uint16_t id, NMEA_TypeStats_t* stats);
+/* Parser restarts between sentences (e.g. after the ring was reset) */
+void NMEA_Reset(NMEA_Parser_t* parser);
+/* Consumes ring[from..to) (wrapping); returns 'to' */
+uint16_t NMEA_Feed(NMEA_Parser_t* parser, const uint8_t* ring, uint16_t ringSize,
+                   uint16_t from, uint16_t to);
+
+/* Field access, index 0 = address; out of range reads as an empty field */
+uint8_t NMEA_FieldLen(const NMEA_Sentence_t* s, uint8_t index);
+char NMEA_FieldChar(const NMEA_Sentence_t* s, uint8_t index, uint8_t pos);
+/* 'digits' decimal digits from 'pos'; false if any is missing or not a digit */
+bool NMEA_FieldDigits(const NMEA_Sentence_t* s, uint8_t index, uint8_t pos, uint8_t digits, uint32_t* value);
+/* Leading unsigned integer, stops at the first non-digit ("12.5" -> 12) */
+bool NMEA_FieldUInt(const NMEA_Sentence_t* s, uint8_t index, uint32_t* value);
+/* Fixed point: "1.27" with decimals = 1 -> 12 (extra digits are cut) */
+bool NMEA_FieldDecimal(const NMEA_Sentence_t* s, uint8_t index, uint8_t decimals, uint32_t* value);
+
+#endif /* INC_NMEA_H_ */
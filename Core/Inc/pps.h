@@ -0,0 +1,60 @@
+/*
+ * pps.h
+ *
+ *  GPS 1PPS on TIM2 CH1 (PA15), input capture at 1 MHz.
+ *
+ *  The rising edge of the PPS is the start of a UTC second; the RMC / ZDA
+ *  sentence that names that second comes some hundreds of ms later. The
+ *  capture ISR hands the edge time to PPS_Capture(); when a sentence has
+ *  been parsed, PPS_Associate() returns the edge that preceded its end, so
+ *  the time in the sentence can be applied to that edge instead of to the
+ *  moment it was read.
+ *
+ *  The PPS is trusted after PPS_LOCK_EDGES periods of 1 s +- tolerance in
+ *  a row. A period outside it (noise, missed edge) or no edge for
+ *  PPS_TIMEOUT_US drops back to NMEA-only timing until it locks again.
+ *
+ *  No HAL here: times are timer ticks (us, free-running 32 bit), so the
+ *  module runs on the host against a simulated capture stream.
+ */
+
+#ifndef INC_PPS_H_
+#define INC_PPS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PPS_TIMER_HZ       1000000UL  /* TIM2 count rate */
+#define PPS_PERIOD_US      1000000UL
+#define PPS_TOLERANCE_US   500U       /* Accepted period error (HSE +-50 ppm is 50 us) */
+#define PPS_LOCK_EDGES     3U
+#define PPS_TIMEOUT_US     1500000UL
+#define PPS_NMEA_MAX_US    990000UL   /* Edge -> sentence end; later: not that edge */
+
+typedef struct
+{
+  /* Edges (capture ISR) */
+  uint32_t edges;
+  uint32_t glitches;         /* Period outside tolerance */
+  uint32_t locks;            /* NMEA only -> locked */
+  uint32_t periodUs;         /* Mean period, timer us (HSE error included) */
+  int32_t  jitterLastUs;     /* Last period - mean */
+  uint32_t jitterMaxUs;      /* Largest |jitter| while locked */
+  /* Sentences (main context) */
+  uint32_t associated;       /* Sentence times tied to an edge */
+  uint32_t nmeaOnly;         /* Sentence times used without a PPS */
+  uint32_t nmeaDelayLastUs;  /* Edge -> end of the sentence naming it */
+  uint32_t nmeaDelayMinUs;
+  uint32_t nmeaDelayMaxUs;
+} PPS_Stats_t;
+
+void PPS_Init(void);
+/* Capture ISR: timer value latched at the edge */
+void PPS_Capture(uint32_t edgeUs);
+/* Main context. endUs: timer value when the sentence ended. True if the
+   PPS is locked and an edge precedes endUs by at most PPS_NMEA_MAX_US;
+   *edgeUs is then that edge. */
+bool PPS_Associate(uint32_t endUs, uint32_t* edgeUs);
+void PPS_GetStats(PPS_Stats_t* stats);
+
+#endif /* INC_PPS_H_ */
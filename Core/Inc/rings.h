@@ -0,0 +1,71 @@
+/*
+ * rings.h
+ *
+ *  Seconds-ring and hour-ring modes as data.
+ *
+ *  A ring pattern is a 60-entry (seconds) or 12-entry (hours) mask bank
+ *  generated at compile time into flash, or an O(1) closed-form mask, plus
+ *  a constant mask ORed on top (marks). Drawing a mode is one table or
+ *  expression lookup and one field write, whatever the pattern looks like.
+ *
+ *  New patterns are declared in rings.c: a bank macro or an expression,
+ *  and an entry in the mode table. The menu takes its mode ranges from
+ *  the *_MODE_COUNT values below.
+ */
+
+#ifndef INC_RINGS_H_
+#define INC_RINGS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "display.h"
+
+/* Seconds ring modes (MENU_ITEM_SECD) */
+typedef enum
+{
+  RING_SEC_SINGLE = 0,      /* One LED on the second */
+  RING_SEC_ACCUMULATE,      /* 1..second lit, empty on second 0 */
+  RING_SEC_FILL,            /* 0..second lit */
+  RING_SEC_EVEN_ODD,        /* Fills on even minutes, empties on odd ones */
+  RING_SEC_COMET,           /* Head on the second and a tail of 3 */
+  RING_SEC_SPLIT,           /* Two LEDs running apart from 0 and meeting at 30 */
+  RING_SEC_QUARTERS,        /* Single second over the quarter marks */
+  RING_SEC_FIVES,           /* Single second over a mark every 5 s */
+  RING_SEC_COMET_FADE,      /* Comet whose tail fades out (grey levels) */
+  RING_SECONDS_MODE_COUNT
+} RING_SecondsMode_t;
+
+/* Hour ring modes (MENU_ITEM_HOUR): outer and inner ring together */
+typedef enum
+{
+  RING_HOUR_BOTH_FULL = 0,
+  RING_HOUR_INNER_FULL,
+  RING_HOUR_OUTER_FULL,
+  RING_HOUR_OFF,
+  RING_HOUR_QUARTERS_HAND,  /* Quarter marks outside, hour inside */
+  RING_HOUR_HAND_FILL,      /* Hour outside, 0..hour inside */
+  RING_HOUR_HAND_TRAIL,     /* Hour and the one before on both rings */
+  RING_HOURS_MODE_COUNT
+} RING_HoursMode_t;
+
+/* Menu modes go into a 4-bit field of the render key */
+_Static_assert(RING_SECONDS_MODE_COUNT <= 16U, "seconds ring modes must fit in 4 bits");
+_Static_assert(RING_HOURS_MODE_COUNT <= 16U, "hour ring modes must fit in 4 bits");
+
+/* Masks, bit n = LED n; an unknown mode gives an empty ring */
+uint64_t RING_SecondsMask(uint8_t mode, uint8_t second, uint8_t minute);
+void RING_HoursMasks(uint8_t mode, uint8_t hour, uint16_t* outer, uint16_t* inner);
+
+/* Grey-level modes. RING_SecondsMask() gives such a mode as plain on/off
+   LEDs; its levels need the BCM engine (display_bcm.h). RING_SecondsLevels()
+   fills level[n] of LED n, 0..'full', for any mode: mask LEDs at 'full',
+   then the fade of a grey-level mode on top. */
+bool RING_SecondsHasLevels(uint8_t mode);
+void RING_SecondsLevels(uint8_t mode, uint8_t second, uint8_t minute, uint8_t full,
+                        uint8_t level[FRAME_LEN_SECONDS_RING]);
+
+/* Write the ring fields of a frame (hour: 0..23) */
+void RING_DrawSeconds(DisplayFrame_t* frame, uint8_t mode, uint8_t second, uint8_t minute);
+void RING_DrawHours(DisplayFrame_t* frame, uint8_t mode, uint8_t hour);
+
+#endif /* INC_RINGS_H_ */
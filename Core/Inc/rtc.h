@@ -35,13 +35,29 @@ extern "C" {
 extern RTC_HandleTypeDef hrtc;
 
 /* USER CODE BEGIN Private defines */
+/* Calendar snapshot exactly as the RTC holds it (BCD) */
+typedef struct
+{
+  uint32_t tr;    /* RTC_TR: HT HU : MNT MNU : ST SU */
+  uint32_t dr;    /* RTC_DR: YT YU, WDU, MT MU, DT DU */
+  uint32_t ssr;   /* RTC_SSR: counts down from PREDIV_S */
+} RTC_Raw_t;
 
+extern RTC_Raw_t rtcRaw;  /* Last snapshot, read every main loop pass */
+
+/* 1 = RTC 1 Hz calibration output on PC13 (RTC_AF1). Its rising edge is the
+   second edge; a scope between it and SPI1_LATCH (PA6) shows the true
+   latch error of the second-locked frames */
+#define RTC_SECOND_PROBE_OUTPUT  0
 /* USER CODE END Private defines */
 
 void MX_RTC_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+void RTC_ReadRaw(RTC_Raw_t* raw);
+void RTC_RawToTime(const RTC_Raw_t* raw, RTC_TimeTypeDef* time, RTC_DateTypeDef* date);
+uint16_t RTC_SubsecondMillis(const RTC_Raw_t* raw);
+void RTC_RawNextSecond(RTC_Raw_t* raw);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
@@ -0,0 +1,61 @@
+/*
+ * sched.h
+ *
+ *  Cooperative run-to-completion task scheduler for the main context.
+ *
+ *  A task is released periodically (every periodMs, on the 1 ms HAL tick),
+ *  by events set from interrupts (SCHED_SetEvent), or both. Ready tasks
+ *  run one at a time in registration order, highest priority first; after
+ *  every task the scan starts again from the top. When nothing is ready
+ *  the core sleeps in WFI until the next interrupt (SysTick at the latest).
+ *
+ *  A task misses its deadline when it finishes more than deadlineMs after
+ *  its release. For events the release is the first scheduler pass that
+ *  sees the event, normally right after the WFI wake-up.
+ */
+
+#ifndef INC_SCHED_H_
+#define INC_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_MAX_TASKS        8U
+
+/* Events, set from interrupts */
+#define SCHED_EVT_RTC_SECOND   (1UL << 0)   /* RTC wakeup: second edge */
+#define SCHED_EVT_GPS_RX       (1UL << 1)   /* USART1 IDLE, RX DMA half / full */
+#define SCHED_EVT_AMBIENT      (1UL << 2)   /* ADC1 DMA half / full */
+#define SCHED_EVT_INPUT        (1UL << 3)   /* INPUT_Push(), see input.h */
+
+#define SCHED_NO_DEADLINE      0U
+
+typedef void (*SCHED_TaskFn_t)(void);
+
+typedef struct
+{
+  const char* name;
+  uint32_t runs;
+  uint32_t misses;        /* Deadline misses */
+  uint32_t cyclesLast;    /* Run time, DWT cycles (SYSCLK) */
+  uint32_t cyclesMax;
+  uint64_t cyclesTotal;
+  uint32_t lateMaxMs;     /* Worst release -> finish */
+} SCHED_Stats_t;
+
+/* Before SCHED_Run(). periodMs = 0: events only; events = 0: periodic only.
+   Returns the task id, or -1 if the table is full. */
+int8_t SCHED_AddTask(const char* name, SCHED_TaskFn_t fn, uint32_t periodMs,
+                     uint32_t deadlineMs, uint32_t events);
+/* Any context, any priority */
+void SCHED_SetEvent(uint32_t events);
+/* Main loop, does not return */
+void SCHED_Run(void);
+
+bool SCHED_GetStats(uint8_t id, SCHED_Stats_t* stats);
+uint8_t SCHED_TaskCount(void);
+/* DWT cycles spent in WFI since start / the last reset */
+uint64_t SCHED_IdleCycles(void);
+void SCHED_ResetStats(void);
+
+#endif /* INC_SCHED_H_ */
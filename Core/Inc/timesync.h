@@ -0,0 +1,89 @@
+/*
+ * timesync.h
+ *
+ *  Keeps the RTC on GPS time by steering it instead of rewriting it.
+ *
+ *  Every reference sample (GPS time at the instant of an RTC snapshot,
+ *  sub-seconds from SSR included) gives the phase offset reference - RTC.
+ *  Depending on its size the RTC is:
+ *   - stepped (calendar written, HAL_RTC_SetTime/SetDate) when the offset
+ *     is over TSYNC_STEP_MS or the date differs - first fix, DST change;
+ *   - shifted (RTC_SHIFTR: ADD1S / SUBFS, no init mode, no reset of the
+ *     prescalers) when it is outside the +-TSYNC_DEADBAND_MS band. With
+ *     NMEA timing a single sentence can be tens of ms late, so the band is
+ *     applied to the median of the last TSYNC_NMEA_MEDIAN offsets;
+ *   - left alone otherwise.
+ *  Over TSYNC_FREQ_WINDOW_S the free-running phase (offset with the shifts
+ *  added back) gives the LSE frequency error, which smooth calibration
+ *  (RTC_CALR, 0.954 ppm per pulse) takes out. Once it has settled the
+ *  shifts become rare, so the RTC is written a few times a day instead of
+ *  every second.
+ *
+ *  Ticks are RTC sub-second units, 1 / (PREDIV_S + 1) s.
+ */
+
+#ifndef INC_TIMESYNC_H_
+#define INC_TIMESYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+#define TSYNC_STEP_MS        500     /* Larger offset: set the calendar */
+#define TSYNC_DEADBAND_MS    20      /* Smaller offset: no correction (NMEA) */
+#define TSYNC_NMEA_MEDIAN    7U      /* NMEA offsets are judged by the median of this many */
+#define TSYNC_DEADBAND_PPS_US 500    /* The same with the PPS as reference */
+#define TSYNC_FREQ_WINDOW_S  4096U   /* Frequency measurement interval */
+#define TSYNC_LOG_SIZE       16U
+
+typedef enum
+{
+  TSYNC_NONE = 0,
+  TSYNC_STEP,
+  TSYNC_SHIFT,
+  TSYNC_CALIBRATE            /* New frequency estimate, CALR written */
+} TSYNC_Action_t;
+
+typedef enum
+{
+  TSYNC_SRC_NMEA = 0,        /* Sentence arrival, receiver delay estimated */
+  TSYNC_SRC_PPS              /* Sentence time tied to its 1PPS edge (pps.h) */
+} TSYNC_Source_t;
+
+typedef struct
+{
+  uint32_t samples;
+  uint32_t steps;
+  uint32_t shifts;
+  uint32_t calibrations;
+  int32_t  offsetMs;         /* Last offset, reference - RTC (+: RTC late) */
+  int32_t  offsetUs;         /* The same in us, when under a second */
+  uint8_t  source;           /* TSYNC_Source_t of the last sample */
+  int32_t  freqPpb;          /* Last frequency error measured, +: RTC slow */
+  int16_t  calPulses;        /* Smooth calibration, pulses added per 2^20 */
+} TSYNC_Stats_t;
+
+typedef struct
+{
+  uint32_t time;             /* Reference, seconds since 2000-01-01 local */
+  int32_t  offsetMs;
+  int32_t  freqPpb;
+  int16_t  calPulses;
+  uint8_t  action;           /* TSYNC_Action_t */
+  uint8_t  source;           /* TSYNC_Source_t */
+} TSYNC_LogEntry_t;
+
+/* After MX_RTC_Init(): picks up the calibration kept in the backup domain */
+void TSYNC_Init(void);
+/* Main context. refTime / refDate: local time of the reference (binary),
+   refTicks: ticks past that second (may be more than one second). rtc: RTC
+   snapshot taken at the same instant. A change of source restarts the
+   frequency measurement (the two differ by the receiver delay). */
+TSYNC_Action_t TSYNC_Update(const RTC_TimeTypeDef* refTime, const RTC_DateTypeDef* refDate,
+                            uint32_t refTicks, const RTC_Raw_t* rtc, TSYNC_Source_t source);
+
+void TSYNC_GetStats(TSYNC_Stats_t* stats);
+/* age 0 = newest; false if there is no such entry */
+bool TSYNC_GetLog(uint8_t age, TSYNC_LogEntry_t* entry);
+
+#endif /* INC_TIMESYNC_H_ */
@@ -0,0 +1,170 @@
+/*
+ * ambient.c
+ *
+ *  Ambient light acquisition and auto-brightness, see ambient.h
+ */
+
+#include "ambient.h"
+#include "brightness.h"
+#include "main.h"
+#include "adc.h"
+#include "tim.h"
+#include "sched.h"
+
+#define AMBIENT_HALF  (AMBIENT_SAMPLES / 2U)
+
+static uint16_t s_samples[AMBIENT_SAMPLES];     // Written by DMA
+static volatile uint8_t s_ready = 0;            // Bit 0: first half full, bit 1: second half
+
+static uint32_t s_filtered = 0;                 // IIR state, reading << 8
+static bool     s_primed = false;
+static uint16_t s_applied = 0;                  // Reading the current level was chosen for
+static bool     s_auto = true;
+static bool     s_recheck = false;              // Skip the hysteresis once (new curve / auto on)
+
+/* Default curve for an LDR divider (brighter room = higher voltage) */
+static AMBIENT_Point_t s_curve[AMBIENT_MAX_POINTS] = {
+    {     0,   40 },
+    {  2000,  120 },
+    {  8000,  300 },
+    { 24000,  650 },
+    { 50000, 1023 },
+};
+static uint8_t s_curvePoints = 5;
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc)
+{
+    if (hadc->Instance == ADC1) {
+        s_ready |= 0x01U;
+        SCHED_SetEvent(SCHED_EVT_AMBIENT);
+    }
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
+{
+    if (hadc->Instance == ADC1) {
+        s_ready |= 0x02U;
+        SCHED_SetEvent(SCHED_EVT_AMBIENT);
+    }
+}
+
+// 32 x 12 bits = 17 bits; the top 16 of them
+static uint16_t Decimate(const uint16_t* half)
+{
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < AMBIENT_HALF; i++) {
+        sum += half[i];
+    }
+    return (uint16_t)(sum >> 1);
+}
+
+static uint16_t CurveLevel(uint16_t reading)
+{
+    if (reading <= s_curve[0].reading) {
+        return s_curve[0].level;
+    }
+    for (uint8_t i = 1; i < s_curvePoints; i++) {
+        const AMBIENT_Point_t* a = &s_curve[i - 1U];
+        const AMBIENT_Point_t* b = &s_curve[i];
+        if (reading <= b->reading) {
+            int32_t span = (int32_t)b->reading - (int32_t)a->reading;
+            int32_t rise = (int32_t)b->level - (int32_t)a->level;
+            return (uint16_t)((int32_t)a->level + (rise * ((int32_t)reading - (int32_t)a->reading)) / span);
+        }
+    }
+    return s_curve[s_curvePoints - 1U].level;
+}
+
+void AMBIENT_Start(void)
+{
+    s_ready = 0;
+    s_primed = false;
+    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*)s_samples, AMBIENT_SAMPLES) != HAL_OK) {
+        Error_Handler();
+    }
+    /* CC1 rising edge, once per TIM5 period, is the conversion trigger */
+    if (HAL_TIM_PWM_Start(&htim5, TIM_CHANNEL_1) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+void AMBIENT_Process(void)
+{
+    if (s_ready == 0U) {
+        return;
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t ready = s_ready;
+    s_ready = 0;
+    __set_PRIMASK(primask);
+
+    /* Only the half just completed; the DMA is filling the other one */
+    const uint16_t* half = (ready & 0x02U) ? &s_samples[AMBIENT_HALF] : s_samples;
+    uint16_t x = Decimate(half);
+
+    if (!s_primed) {
+        s_filtered = (uint32_t)x << 8;
+        s_primed = true;
+        s_applied = x;
+        if (s_auto) {
+            BRIGHT_SetLevel(CurveLevel(x));
+        }
+        return;
+    }
+    int32_t diff = ((int32_t)x << 8) - (int32_t)s_filtered;
+    s_filtered = (uint32_t)((int32_t)s_filtered + (diff >> AMBIENT_IIR_SHIFT));
+
+    if (!s_auto || BRIGHT_IsBusy()) {
+        return;                      // Fade or another effect running: next reading
+    }
+    uint16_t y = (uint16_t)(s_filtered >> 8);
+    uint16_t band = s_applied >> AMBIENT_HYST_SHIFT;
+    if (band < AMBIENT_HYST_MIN) band = AMBIENT_HYST_MIN;
+    uint16_t delta = (y > s_applied) ? (y - s_applied) : (s_applied - y);
+    if (delta <= band && !s_recheck) {
+        return;
+    }
+
+    uint16_t level = CurveLevel(y);
+    if (level == BRIGHT_GetLevel() || BRIGHT_Fade(level, AMBIENT_FADE_MS, NULL)) {
+        s_applied = y;
+        s_recheck = false;
+    }
+}
+
+uint16_t AMBIENT_GetReading(void)
+{
+    return (uint16_t)(s_filtered >> 8);
+}
+
+bool AMBIENT_SetCurve(const AMBIENT_Point_t* points, uint8_t count)
+{
+    if (count == 0U || count > AMBIENT_MAX_POINTS) {
+        return false;
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        if (points[i].reading <= points[i - 1U].reading) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        s_curve[i] = points[i];
+    }
+    s_curvePoints = count;
+    s_recheck = true;
+    return true;
+}
+
+void AMBIENT_SetAuto(bool on)
+{
+    if (on && !s_auto) {
+        s_recheck = true;
+    }
+    s_auto = on;
+}
+
+bool AMBIENT_IsAuto(void)
+{
+    return s_auto;
+}
@@ -0,0 +1,401 @@
+/*
+ * brightness.c
+ *
+ *  TIM1 CH1 brightness PWM and DMA-driven effects, see brightness.h
+ */
+
+#include "brightness.h"
+#include "main.h"     // htim1
+
+/* CIE 1931 lightness -> relative luminance, full scale 65535.
+   L* = 100 * level / 1023; Y = ((L* + 16) / 116)^3 above L* = 8,
+   L* / 903.3 below. (L* + 16) / 116 is taken in Q20, so the cube stays
+   within 64 bits. */
+#define CIE_T(l)    ((((uint64_t)(100U * (l) + 16U * BRIGHT_LEVEL_MAX)) << 20) / (116U * BRIGHT_LEVEL_MAX))
+#define CIE_Y(l)    (uint16_t)((100U * (l) <= 8U * BRIGHT_LEVEL_MAX)                                     \
+                    ? ((65535ULL * 1000U * (l)) / (BRIGHT_LEVEL_MAX * 9033ULL))                           \
+                    : ((((CIE_T(l) * CIE_T(l)) >> 20) * CIE_T(l) * 65535ULL) >> 40))
+#define CIE_4(l)    CIE_Y(l), CIE_Y((l) + 1U), CIE_Y((l) + 2U), CIE_Y((l) + 3U)
+#define CIE_16(l)   CIE_4(l), CIE_4((l) + 4U), CIE_4((l) + 8U), CIE_4((l) + 12U)
+#define CIE_64(l)   CIE_16(l), CIE_16((l) + 16U), CIE_16((l) + 32U), CIE_16((l) + 48U)
+#define CIE_256(l)  CIE_64(l), CIE_64((l) + 64U), CIE_64((l) + 128U), CIE_64((l) + 192U)
+
+static const uint16_t s_luminance[BRIGHT_LEVELS] = {
+    CIE_256(0U), CIE_256(256U), CIE_256(512U), CIE_256(768U)
+};
+
+typedef enum
+{
+    BRIGHT_IDLE = 0,   // CCR1 written directly
+    BRIGHT_HOLD,       // Circular dither pattern of s_level
+    BRIGHT_EFFECT      // Effect, refilled into s_out period by period
+} BrightMode_t;
+
+/* Effect output: the DMA plays s_out circularly, one CCR1 value per PWM
+   period, and the interrupt at the end of each half refills that half */
+#define BRIGHT_OUT_HALF     32U
+
+static uint16_t s_fine[BRIGHT_WAVE_LEN];  // Effect samples: CCR1 in 1/BRIGHT_DITHER_LEN counts
+static uint16_t s_lvl[BRIGHT_WAVE_LEN];   // Level of each sample, for BRIGHT_GetLevel()
+static uint16_t s_out[2U * BRIGHT_OUT_HALF];
+static uint16_t s_dither[BRIGHT_DITHER_LEN];
+static uint16_t s_len = 0;
+static uint16_t s_stepMs = 1;
+static uint16_t s_level = 0;              // Level held / at the start of an effect
+static uint8_t  s_error = 0;              // Sigma-delta accumulator, 1/BRIGHT_DITHER_LEN counts
+
+/* Effect playback, advanced one PWM period per output value */
+static uint16_t s_pos = 0;                // Sample being written out
+static uint32_t s_left = 0;               // PWM periods left of it
+static uint32_t s_stepPeriods = 1;        // PWM periods per sample
+static uint16_t s_halfPos[2];             // Sample at the start of each half of s_out
+static volatile uint16_t s_playPos = 0;   // Sample at the start of the half being played
+static uint8_t  s_endIn = 0;              // Half-buffer ends until the last level is surely on
+
+static volatile BrightMode_t s_mode = BRIGHT_IDLE;
+static bool s_loop = false;
+static BRIGHT_Callback_t s_done = NULL;
+
+// CCR1 for a level in 1/BRIGHT_DITHER_LEN counts
+static uint32_t LevelToFine(uint16_t level)
+{
+    uint64_t period = __HAL_TIM_GET_AUTORELOAD(&htim1) + 1U;
+    return (uint32_t)((period * s_luminance[level] * BRIGHT_DITHER_LEN + 32767U) / 65535U);
+}
+
+// Next whole-count sample; the dropped fraction is carried to the next one
+static uint16_t DitherSample(uint32_t fine)
+{
+    uint32_t ccr = fine >> BRIGHT_DITHER_BITS;
+    s_error += (uint8_t)(fine & (BRIGHT_DITHER_LEN - 1U));
+    if (s_error >= BRIGHT_DITHER_LEN) {
+        s_error -= BRIGHT_DITHER_LEN;
+        ccr++;
+    }
+    return (uint16_t)ccr;
+}
+
+static void Push(uint16_t level)
+{
+    if (s_len < BRIGHT_WAVE_LEN) {
+        s_lvl[s_len] = level;
+        s_fine[s_len] = (uint16_t)LevelToFine(level);
+        s_len++;
+    }
+}
+
+// Linear ramp; the first sample is one step past 'from', the last one is 'to'
+static void Ramp(uint16_t from, uint16_t to, uint32_t ms)
+{
+    uint32_t n = ms / s_stepMs;
+    if (n == 0U) n = 1U;
+    for (uint32_t k = 1; k <= n; k++) {
+        int32_t level = (int32_t)from + (((int32_t)to - (int32_t)from) * (int32_t)k) / (int32_t)n;
+        Push((uint16_t)level);
+    }
+}
+
+static uint16_t ClampLevel(uint16_t level)
+{
+    return (level > BRIGHT_LEVEL_MAX) ? BRIGHT_LEVEL_MAX : level;
+}
+
+// TIM1 update events (PWM periods) per millisecond
+static uint32_t PeriodsPerMs(void)
+{
+    uint32_t timClk = HAL_RCC_GetPCLK2Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_HCLK_DIV1) {
+        timClk *= 2U;   // APB2 timers run at 2x PCLK2 when APB2 is divided
+    }
+    uint32_t period = (htim1.Instance->PSC + 1U) * (__HAL_TIM_GET_AUTORELOAD(&htim1) + 1U);
+    uint32_t perMs = timClk / (period * 1000U);
+    return (perMs == 0U) ? 1U : perMs;
+}
+
+static void StopDma(void)
+{
+    /* With the DMA interrupt masked, a completion cannot restart the
+       stream between the abort and the mode change */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (s_mode != BRIGHT_IDLE) {
+        __HAL_TIM_DISABLE_DMA(&htim1, TIM_DMA_UPDATE);
+        HAL_DMA_Abort(htim1.hdma[TIM_DMA_ID_UPDATE]);
+        s_mode = BRIGHT_IDLE;
+    }
+    __set_PRIMASK(primask);
+}
+
+static void BRIGHT_DmaError(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    __HAL_TIM_DISABLE_DMA(&htim1, TIM_DMA_UPDATE);   // Stream is disabled by HAL
+    s_mode = BRIGHT_IDLE;
+    s_done = NULL;
+}
+
+/* One half of s_out, one value per PWM period: the sigma-delta runs on
+   every period, so even an effect sample lasting many periods spreads its
+   fraction at the full PWM rate. Past the end of a one-shot effect the
+   last sample just repeats. */
+static void Refill(uint8_t half)
+{
+    uint16_t* out = &s_out[half * BRIGHT_OUT_HALF];
+    s_halfPos[half] = s_pos;
+
+    for (uint8_t i = 0; i < BRIGHT_OUT_HALF; i++) {
+        out[i] = DitherSample(s_fine[s_pos]);
+        if (--s_left == 0U) {
+            s_left = s_stepPeriods;
+            if (s_pos + 1U < s_len) {
+                s_pos++;
+            } else if (s_loop) {
+                s_pos = 0;
+            } else if (s_endIn == 0U) {
+                /* The rest of this half holds the last level; it plays once the
+                   other half is done, and is over at the end after that */
+                s_endIn = 2U;
+            }
+        }
+    }
+}
+
+static void Hold(uint16_t level);
+
+// End of half 'half' of s_out: the DMA plays the other half now
+static void HalfDone(uint8_t half)
+{
+    if (s_mode != BRIGHT_EFFECT) {
+        return;
+    }
+    s_playPos = s_halfPos[half ^ 1U];
+
+    if (s_endIn != 0U && --s_endIn == 0U) {
+        Hold(s_lvl[s_len - 1U]);
+
+        BRIGHT_Callback_t done = s_done;
+        s_done = NULL;
+        if (done != NULL) {
+            done();
+        }
+        return;
+    }
+    Refill(half);
+}
+
+static void BRIGHT_DmaHalf(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    HalfDone(0U);
+}
+
+static void BRIGHT_DmaCplt(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    HalfDone(1U);
+}
+
+/* Plays 'count' CCR1 values circularly, one per PWM period. With 'refill'
+   the interrupt at the end of each half refills it from the effect. */
+static bool StartDma(const uint16_t* table, uint16_t count, bool refill)
+{
+    DMA_HandleTypeDef* hdma = htim1.hdma[TIM_DMA_ID_UPDATE];
+    hdma->XferCpltCallback = refill ? BRIGHT_DmaCplt : NULL;
+    hdma->XferHalfCpltCallback = refill ? BRIGHT_DmaHalf : NULL;
+    hdma->XferErrorCallback = BRIGHT_DmaError;
+
+    /* A DMA request on every update event; UG restarts the period
+       (one shortened PWM period, not visible) */
+    htim1.Instance->RCR = 0U;
+    htim1.Instance->EGR = TIM_EGR_UG;
+
+    if (HAL_DMA_Start_IT(hdma, (uint32_t)table, (uint32_t)&htim1.Instance->CCR1, count) != HAL_OK) {
+        return false;
+    }
+    __HAL_TIM_ENABLE_DMA(&htim1, TIM_DMA_UPDATE);
+    return true;
+}
+
+/* Static level: whole counts go straight to CCR1, a fraction needs the
+   dither pattern, one sample per PWM period */
+static void Hold(uint16_t level)
+{
+    StopDma();
+    s_level = level;
+
+    uint32_t fine = LevelToFine(level);
+    if ((fine & (BRIGHT_DITHER_LEN - 1U)) == 0U) {
+        __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, fine >> BRIGHT_DITHER_BITS);
+        return;
+    }
+    s_error = 0;
+    for (uint8_t i = 0; i < BRIGHT_DITHER_LEN; i++) {
+        s_dither[i] = DitherSample(fine);
+    }
+    if (StartDma(s_dither, BRIGHT_DITHER_LEN, false)) {
+        s_mode = BRIGHT_HOLD;
+    } else {
+        __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, fine >> BRIGHT_DITHER_BITS);
+    }
+}
+
+// Picks the step length for an effect of 'totalMs' and empties the table
+static bool Begin(uint32_t totalMs)
+{
+    uint32_t step = (totalMs + BRIGHT_WAVE_LEN - 1U) / BRIGHT_WAVE_LEN;
+    if (step > BRIGHT_MAX_STEP_MS) {
+        return false;
+    }
+    BRIGHT_Stop();
+    s_stepMs = (uint16_t)((step == 0U) ? 1U : step);
+    s_len = 0;
+    return true;
+}
+
+static bool Run(bool loop, BRIGHT_Callback_t done)
+{
+    if (s_len == 0U) {
+        return false;
+    }
+
+    StopDma();
+    s_done = done;
+    s_loop = loop;
+    s_pos = 0;
+    s_playPos = 0;
+    s_endIn = 0;
+    s_stepPeriods = s_stepMs * PeriodsPerMs();
+    s_left = s_stepPeriods;
+    Refill(0U);
+    Refill(1U);
+
+    s_mode = BRIGHT_EFFECT;          // Before the start: the first half may end at once
+    if (!StartDma(s_out, 2U * BRIGHT_OUT_HALF, true)) {
+        s_mode = BRIGHT_IDLE;
+        s_done = NULL;
+        Hold(s_level);
+        return false;
+    }
+    return true;
+}
+
+void BRIGHT_Stop(void)
+{
+    if (s_mode == BRIGHT_EFFECT) {
+        uint16_t level = BRIGHT_GetLevel();
+        s_done = NULL;
+        Hold(level);
+    }
+}
+
+bool BRIGHT_IsBusy(void)
+{
+    return (s_mode == BRIGHT_EFFECT);
+}
+
+uint16_t BRIGHT_GetLevel(void)
+{
+    if (s_mode != BRIGHT_EFFECT) {
+        return s_level;
+    }
+    return s_lvl[s_playPos];         // Up to one half of s_out (8 ms) behind
+}
+
+void BRIGHT_SetLevel(uint16_t level)
+{
+    s_done = NULL;
+    Hold(ClampLevel(level));
+}
+
+bool BRIGHT_Sequence(const BRIGHT_Step_t* steps, uint8_t count, BRIGHT_Callback_t done)
+{
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        total += steps[i].ms;
+    }
+    if (!Begin(total)) {
+        return false;
+    }
+    uint16_t level = s_level;
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t to = ClampLevel(steps[i].level);
+        if (steps[i].ms != 0U) {
+            Ramp(level, to, steps[i].ms);
+        }
+        level = to;
+    }
+    if (s_len == 0U) {
+        Push(level);                 // Only jumps: the last one still takes effect
+    }
+    return Run(false, done);
+}
+
+bool BRIGHT_Fade(uint16_t level, uint32_t ms, BRIGHT_Callback_t done)
+{
+    BRIGHT_Step_t step = { level, ms };
+    return BRIGHT_Sequence(&step, 1, done);
+}
+
+bool BRIGHT_Flash(uint16_t level, uint32_t onMs, uint32_t offMs, uint8_t count, BRIGHT_Callback_t done)
+{
+    if (count == 0U || !Begin((onMs + offMs) * count)) {
+        return false;
+    }
+    uint16_t base = s_level;
+    uint16_t flash = ClampLevel(level);
+    for (uint8_t i = 0; i < count; i++) {
+        Ramp(flash, flash, onMs);
+        Ramp(base, base, offMs);
+    }
+    return Run(false, done);
+}
+
+bool BRIGHT_Breathe(uint16_t low, uint16_t high, uint32_t periodMs)
+{
+    if (!Begin(periodMs)) {
+        return false;
+    }
+    uint16_t lo = ClampLevel(low);
+    uint16_t hi = ClampLevel(high);
+    Ramp(lo, hi, periodMs / 2U);
+    Ramp(hi, lo, periodMs - periodMs / 2U);
+    return Run(true, NULL);
+}
+
+void SetPWMValue(uint16_t value) {
+  s_done = NULL;
+  StopDma();
+  if (value > __HAL_TIM_GET_AUTORELOAD(&htim1)) {
+    value = __HAL_TIM_GET_AUTORELOAD(&htim1);
+  }
+  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, value);
+}
+
+void SetPWMPercent(uint8_t percent) {
+  s_done = NULL;
+  StopDma();
+  if (percent > 100) {
+    percent = 100;
+  }
+  uint32_t period = __HAL_TIM_GET_AUTORELOAD(&htim1);
+  uint32_t compare_value = (period + 1) - ((period + 1) * percent / 100);
+  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, compare_value);
+}
+
+void SetPWMPercentGamma(uint8_t percent) {
+  if (percent > 100) {
+      percent = 100;
+  }
+  BRIGHT_SetLevel((uint16_t)((percent * BRIGHT_LEVEL_MAX + 50U) / 100U));
+}
+
+void FadeEffect(void)
+{
+    static const BRIGHT_Step_t steps[] = {
+        { BRIGHT_LEVEL_MAX / 10U,  200 },
+        { 0,                       500 },
+        { BRIGHT_LEVEL_MAX,       5050 },
+        { BRIGHT_LEVEL_MAX / 10U, 4550 },
+    };
+    BRIGHT_Sequence(steps, sizeof(steps) / sizeof(steps[0]), NULL);
+}
@@ -7,8 +7,8 @@
 #include "display.h"
 #include "slider.h"
 #include "sht30.h"
+#include "input.h"
 
-extern MyClockBitFields clockReg;  /* Globalny rejestr wyświetlacza */
 volatile uint8_t counter = 0;
 
 static EncoderRotateCallback_t s_encoderCb = NULL;  /* Callback enkodera */
@@ -61,7 +61,7 @@ void Button_RegisterDoubleClickCallback(uint8_t buttonIndex, ButtonCallback cb)
 
 extern volatile uint32_t systemTicks;  /* Globalny licznik taktów */
 
-// Funkcja przetwarzająca stany przycisków
+// Funkcja przetwarzająca stany przycisków (przerwanie TIM5, co 10 ms)
 void Button_Process(void) {
     for (int i = 0; i < NUM_BUTTONS; i++) {
         Button_t *btn = &buttons[i];
@@ -94,13 +94,10 @@ void Button_Process(void) {
                         if (btn->clickCount == 2) {
                             btn->waitingForDoubleClick = false;
                             btn->clickCount = 0;
-                            if (btn->onDoubleClick) {
-                                btn->onDoubleClick();
-                            }
+                            INPUT_Push(INPUT_EVT_DOUBLE_CLICK, i, 0);
                         }
                     }
-                    if (btn->onRelease)
-                        btn->onRelease();
+                    INPUT_Push(INPUT_EVT_RELEASE, i, 0);
                 }
             }
         } else {
@@ -110,8 +107,8 @@ void Button_Process(void) {
         /* Timeout dwukliku */
         if (btn->waitingForDoubleClick && ((systemTicks - btn->lastClickTime) > DOUBLE_CLICK_THRESHOLD)) {
             if (btn->clickCount == 1) {
-                if (!btn->holdTriggered && btn->onPress) {
-                    btn->onPress();
+                if (!btn->holdTriggered) {
+                    INPUT_Push(INPUT_EVT_PRESS, i, 0);
                 }
             }
             btn->waitingForDoubleClick = false;
@@ -125,13 +122,11 @@ void Button_Process(void) {
                 btn->holdTriggered = true;
                 btn->clickCount = 0;
                 btn->waitingForDoubleClick = false;
-                if (btn->onHold)
-                    btn->onHold();
+                INPUT_Push(INPUT_EVT_HOLD, i, 0);
                 btn->nextRepeatTime = systemTicks + REPEAT_INTERVAL;
             }
             if (btn->holdTriggered && (systemTicks >= btn->nextRepeatTime)) {
-                if (btn->onRepeat)
-                    btn->onRepeat();
+                INPUT_Push(INPUT_EVT_REPEAT, i, 0);
                 btn->nextRepeatTime += REPEAT_INTERVAL;
             }
         }
@@ -139,14 +134,11 @@ void Button_Process(void) {
 }
 
 
-/* @brief  Callback wywoływany w przerwaniu timera (TIM5). */
-
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
-    if (htim->Instance == TIM5) {
-        SHT30_10msHandler();         /* Obsługa czujnika SHT30 */
-        systemTicks++;               /* Inkrementacja globalnego licznika */
-        SLIDER_Update();             /* Aktualizacja slidera */
-    }
+/* Praca 10 ms w kontekście głównym (zadanie planisty): SHT30 i slider
+   nie są już zmieniane z przerwania w trakcie Display() */
+void Button_Tick10ms(void) {
+    SHT30_10msHandler();         /* Obsługa czujnika SHT30 */
+    SLIDER_Update();             /* Aktualizacja slidera */
     if (colon == 1) {
         if (counter > 0) {
             counter--;             /* Odliczanie */
@@ -155,7 +147,7 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
             colon = 0;             /* Reset stanu colon */
         }
     }
-    static volatile uint16_t cnter = 0;
+    static uint16_t cnter = 0;
     cnter++;
     if (cnter > 400) {
         cnter = 0;
@@ -165,9 +157,43 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
     }
 }
 
-void Encoder_HandleInterrupt(int8_t direction)
+/* @brief  Callback wywoływany w przerwaniu timera (TIM5). */
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    if (htim->Instance == TIM5) {
+        systemTicks++;               /* Inkrementacja globalnego licznika */
+        Button_Process();            /* Debounce; zdarzenia idą do kolejki input.h */
+        INPUT_Flush();
+    }
+}
+
+/* Kontekst główny: zdarzenie z kolejki -> zarejestrowany callback */
+void Button_DispatchEvent(const INPUT_Event_t* event)
 {
-    if (s_encoderCb != NULL) {
-        s_encoderCb(direction);
+    if (event->type == INPUT_EVT_ENCODER) {
+        if (s_encoderCb == NULL) return;
+        /* Kroki zebrane przy pełnej kolejce mogą przekroczyć int8_t */
+        int16_t steps = event->value;
+        while (steps != 0) {
+            int8_t chunk = (steps > INT8_MAX) ? INT8_MAX : (steps < -INT8_MAX) ? -INT8_MAX : (int8_t)steps;
+            s_encoderCb(chunk);
+            steps -= chunk;
+        }
+        return;
+    }
+    if (event->source >= NUM_BUTTONS) return;
+
+    Button_t *btn = &buttons[event->source];
+    ButtonCallback cb = NULL;
+    switch (event->type) {
+    case INPUT_EVT_PRESS:        cb = btn->onPress;       break;
+    case INPUT_EVT_RELEASE:      cb = btn->onRelease;     break;
+    case INPUT_EVT_HOLD:         cb = btn->onHold;        break;
+    case INPUT_EVT_REPEAT:       cb = btn->onRepeat;      break;
+    case INPUT_EVT_DOUBLE_CLICK: cb = btn->onDoubleClick; break;
+    default: break;
+    }
+    if (cb != NULL) {
+        cb();
     }
 }
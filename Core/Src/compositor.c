@@ -0,0 +1,183 @@
+/*
+ * compositor.c
+ *
+ *  Sequence-locked display layers, see compositor.h
+ */
+
+#include "compositor.h"
+#include "main.h"
+
+typedef struct
+{
+  volatile uint32_t seq;        // Odd while the writer is inside Begin/End
+  DisplayFrame_t    frame;      // Writer side
+  DisplayFrame_t    copy;       // Committer side: content as of seenSeq
+  uint32_t          seenSeq;
+  DisplayFrame_t    mask;       // Chain bits the layer owns
+  COMP_Blend_t      blend;
+  bool              enabled;
+} Layer_t;
+
+static Layer_t s_layers[COMP_LAYER_COUNT];
+static DisplayFrame_t s_composite;      // Result of the last merge
+static bool s_setupChanged;
+static COMP_Stats_t s_stats;
+
+static void SetMaskBits(DisplayFrame_t* mask, uint8_t offset, uint8_t width)
+{
+    WriteFrameBits(mask, offset, width, (width >= 64U) ? ~0ULL : ((1ULL << width) - 1U));
+}
+
+void COMP_Init(void)
+{
+    memset(s_layers, 0, sizeof(s_layers));
+    memset(&s_composite, 0, sizeof(s_composite));
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    SetMaskBits(&s_layers[COMP_LAYER_SECONDS].mask, FRAME_OFS_SECONDS_RING, FRAME_LEN_SECONDS_RING);
+    SetMaskBits(&s_layers[COMP_LAYER_HOURS].mask, FRAME_OFS_HOURS_OUTER, FRAME_LEN_HOURS_OUTER);
+    SetMaskBits(&s_layers[COMP_LAYER_HOURS].mask, FRAME_OFS_HOURS_INNER, FRAME_LEN_HOURS_INNER);
+    SetMaskBits(&s_layers[COMP_LAYER_DOTS].mask, FRAME_OFS_DOTS, FRAME_LEN_DOTS);
+    SetMaskBits(&s_layers[COMP_LAYER_TOP].mask, FRAME_OFS_TOP_DISPLAY, FRAME_LEN_TOP_DISPLAY);
+    SetMaskBits(&s_layers[COMP_LAYER_SLIDER].mask, FRAME_OFS_BOTTOM_DISPLAY, FRAME_LEN_BOTTOM_DISPLAY);
+
+    DisplayFrame_t* overlay = &s_layers[COMP_LAYER_OVERLAY].mask;
+    for (uint8_t i = 0; i < COMP_LAYER_OVERLAY; i++) {
+        for (uint8_t w = 0; w < FRAME_WORDS; w++) {
+            overlay->word[w] |= s_layers[i].mask.word[w];     // Every field, no filler
+        }
+        s_layers[i].blend = COMP_BLEND_REPLACE;
+        s_layers[i].enabled = true;
+    }
+    s_layers[COMP_LAYER_OVERLAY].blend = COMP_BLEND_XOR;
+    s_layers[COMP_LAYER_OVERLAY].enabled = false;
+    s_setupChanged = true;
+}
+
+void COMP_SetBlend(COMP_Layer_t layer, COMP_Blend_t blend)
+{
+    s_layers[layer].blend = blend;
+    s_setupChanged = true;
+}
+
+void COMP_SetMask(COMP_Layer_t layer, const DisplayFrame_t* mask)
+{
+    s_layers[layer].mask = *mask;
+    s_setupChanged = true;
+}
+
+void COMP_SetEnabled(COMP_Layer_t layer, bool enabled)
+{
+    if (s_layers[layer].enabled != enabled) {
+        s_layers[layer].enabled = enabled;
+        s_setupChanged = true;
+    }
+}
+
+DisplayFrame_t* COMP_BeginWrite(COMP_Layer_t layer)
+{
+    Layer_t* l = &s_layers[layer];
+    l->seq++;
+    __DMB();                    // Odd count visible before any layer write
+    return &l->frame;
+}
+
+void COMP_EndWrite(COMP_Layer_t layer)
+{
+    Layer_t* l = &s_layers[layer];
+    __DMB();                    // Layer writes visible before the even count
+    l->seq++;
+}
+
+// Copy no writer touched meanwhile; returns the sequence it belongs to
+static uint32_t CopyLayer(const Layer_t* l, DisplayFrame_t* copy)
+{
+    for (;;) {
+        uint32_t seq = l->seq;
+        __DMB();
+        *copy = l->frame;
+        __DMB();
+        if ((seq & 1U) == 0U && seq == l->seq) {
+            return seq;
+        }
+        s_stats.retries++;
+    }
+}
+
+void COMP_ReadLayer(COMP_Layer_t layer, DisplayFrame_t* copy)
+{
+    (void)CopyLayer(&s_layers[layer], copy);
+}
+
+static void Blend(DisplayFrame_t* out, const DisplayFrame_t* src, const Layer_t* l)
+{
+    const uint32_t* m = l->mask.word;
+    const uint32_t* s = src->word;
+    uint32_t* o = out->word;
+
+    switch (l->blend) {
+    case COMP_BLEND_REPLACE:
+        for (uint8_t w = 0; w < FRAME_WORDS; w++) o[w] = (o[w] & ~m[w]) | (s[w] & m[w]);
+        break;
+    case COMP_BLEND_OR:
+        for (uint8_t w = 0; w < FRAME_WORDS; w++) o[w] |= s[w] & m[w];
+        break;
+    case COMP_BLEND_ANDNOT:
+        for (uint8_t w = 0; w < FRAME_WORDS; w++) o[w] &= ~(s[w] & m[w]);
+        break;
+    case COMP_BLEND_XOR:
+        for (uint8_t w = 0; w < FRAME_WORDS; w++) o[w] ^= s[w] & m[w];
+        break;
+    }
+}
+
+bool COMP_Commit(DisplayFrame_t* out)
+{
+    bool changed = s_setupChanged;
+    s_stats.commits++;
+
+    for (uint8_t i = 0; i < COMP_LAYER_COUNT; i++) {
+        Layer_t* l = &s_layers[i];
+        if (l->seq != l->seenSeq) {
+            l->seenSeq = CopyLayer(l, &l->copy);
+            s_stats.layerCopies++;
+            changed |= l->enabled;
+        }
+    }
+
+    if (changed) {
+        memset(&s_composite, 0, sizeof(s_composite));
+        for (uint8_t i = 0; i < COMP_LAYER_COUNT; i++) {
+            if (s_layers[i].enabled) {
+                Blend(&s_composite, &s_layers[i].copy, &s_layers[i]);
+            }
+        }
+        s_setupChanged = false;
+        s_stats.merges++;
+    }
+    *out = s_composite;
+    return changed;
+}
+
+void COMP_Preview(DisplayFrame_t* out, const DisplayFrame_t* const replace[COMP_LAYER_COUNT])
+{
+    memset(out, 0, sizeof(*out));
+    for (uint8_t i = 0; i < COMP_LAYER_COUNT; i++) {
+        const Layer_t* l = &s_layers[i];
+        if (!l->enabled) {
+            continue;
+        }
+        if (replace[i] != NULL) {
+            Blend(out, replace[i], l);
+        } else {
+            DisplayFrame_t copy;
+            (void)CopyLayer(l, &copy);
+            Blend(out, &copy, l);
+        }
+    }
+}
+
+void COMP_GetStats(COMP_Stats_t* stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,137 @@
+/*
+ * decfmt.c
+ *
+ *  Division-free decimal -> 7-seg glyph conversion, see decfmt.h
+ */
+
+#include "decfmt.h"
+#include "display.h"   // SEG_GLYPH_x, SEG_BLANK, SEG_DP
+
+/* Digit pairs 00..99: tens glyph in the low byte, ones glyph in the high byte */
+#define PAIR(t, o)   (uint16_t)(SEG_GLYPH_##t | (SEG_GLYPH_##o << 8))
+#define PAIR_ROW(t)  PAIR(t, 0), PAIR(t, 1), PAIR(t, 2), PAIR(t, 3), PAIR(t, 4), \
+                     PAIR(t, 5), PAIR(t, 6), PAIR(t, 7), PAIR(t, 8), PAIR(t, 9)
+
+static const uint16_t s_pairGlyph[100] = {
+    PAIR_ROW(0), PAIR_ROW(1), PAIR_ROW(2), PAIR_ROW(3), PAIR_ROW(4),
+    PAIR_ROW(5), PAIR_ROW(6), PAIR_ROW(7), PAIR_ROW(8), PAIR_ROW(9)
+};
+
+// Upper 64 bits of a 64x64 product from four 32x32 multiplies (UMULL/UMLAL)
+static uint64_t MulHi64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);   // 64-bit hosts: one native multiply
+#else
+    uint32_t aLo = (uint32_t)a, aHi = (uint32_t)(a >> 32);
+    uint32_t bLo = (uint32_t)b, bHi = (uint32_t)(b >> 32);
+    uint64_t ll = (uint64_t)aLo * bLo;
+    uint64_t lh = (uint64_t)aLo * bHi;
+    uint64_t hl = (uint64_t)aHi * bLo;
+    uint64_t hh = (uint64_t)aHi * bHi;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// n / 10^8 for every uint64_t: 0xABCC77118461CEFD = ceil(2^90 / 10^8)
+static uint64_t DivU64_1e8(uint64_t n)
+{
+    return MulHi64(n, 0xABCC77118461CEFDULL) >> 26;
+}
+
+static inline void PutPair(uint8_t* g, uint32_t value)
+{
+    uint16_t p = s_pairGlyph[value];
+    g[0] = (uint8_t)p;
+    g[1] = (uint8_t)(p >> 8);
+}
+
+static inline uint8_t DigitGlyph(uint32_t digit)
+{
+    return (uint8_t)(s_pairGlyph[digit] >> 8);
+}
+
+// Digits of 'value' ending at g[pos-1]; returns how many were written
+static uint8_t PutDigits(uint32_t value, uint8_t* g, uint8_t pos)
+{
+    uint8_t start = pos;
+
+    /* Four digits per step: the two pairs of a step split independently of
+       the next /10000, so the multiplies overlap instead of chaining */
+    while (value >= 10000U && pos >= 4U) {
+        uint32_t q = DECFMT_Div10000(value);
+        uint32_t r = value - q * 10000U;
+        uint32_t hi = DECFMT_Div100(r);
+        pos -= 4U;
+        PutPair(&g[pos], hi);
+        PutPair(&g[pos + 2U], r - hi * 100U);
+        value = q;
+    }
+    while (value >= 100U && pos >= 2U) {
+        uint32_t q = DECFMT_Div100(value);
+        pos -= 2U;
+        PutPair(&g[pos], value - q * 100U);
+        value = q;
+    }
+    if (pos >= 2U && value >= 10U) {
+        pos -= 2U;
+        PutPair(&g[pos], value);
+    } else if (pos >= 1U) {
+        pos--;
+        g[pos] = DigitGlyph(value - DECFMT_Div10(value) * 10U);
+    }
+    return (uint8_t)(start - pos);
+}
+
+static void Pad(uint8_t* g, uint8_t count, uint8_t flags)
+{
+    uint8_t pad = (flags & DECFMT_ZERO_PAD) ? SEG_GLYPH_0 : SEG_BLANK;
+    for (uint8_t i = 0; i < count; i++) {
+        g[i] = pad;
+    }
+}
+
+void DECFMT_Pair(uint8_t value, uint8_t* glyphs)
+{
+    PutPair(glyphs, (value < 100U) ? value : (uint32_t)(value % 100U));
+}
+
+uint8_t DECFMT_U32(uint32_t value, uint8_t* glyphs, uint8_t width, uint8_t flags)
+{
+    if (width == 0U) return 0;
+    uint8_t n = PutDigits(value, glyphs, width);
+    Pad(glyphs, width - n, flags);
+    return n;
+}
+
+uint8_t DECFMT_U64(uint64_t value, uint8_t* glyphs, uint8_t width, uint8_t flags)
+{
+    if (width == 0U) return 0;
+
+    /* The usual narrow field: only value mod 10^8 can show, one split, and
+       every place is a real digit (value >= 2^32 has ten or more) */
+    if (width <= 8U && (value >> 32) != 0U) {
+        uint32_t low = (uint32_t)(value - DivU64_1e8(value) * 100000000ULL);
+        DECFMT_U32(low, glyphs, width, DECFMT_ZERO_PAD);
+        return width;
+    }
+
+    uint8_t pos = width;
+
+    /* Peel off 8 digits at a time until the rest fits in 32 bits;
+       zeros inside a chunk are real digits, never padding */
+    while ((value >> 32) != 0U) {
+        uint64_t q = DivU64_1e8(value);
+        uint32_t low = (uint32_t)(value - q * 100000000ULL);
+        uint8_t n = (pos < 8U) ? pos : 8U;
+        uint8_t w = PutDigits(low, glyphs, pos);
+        Pad(&glyphs[pos - n], n - w, DECFMT_ZERO_PAD);
+        pos -= n;
+        value = q;
+        if (pos == 0U) return width;
+    }
+    uint8_t n = PutDigits((uint32_t)value, glyphs, pos);
+    Pad(glyphs, pos - n, flags);
+    return (uint8_t)(width - pos + n);
+}
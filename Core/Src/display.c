@@ -6,406 +6,492 @@
  */
 
 #include "display.h"
-#include "main.h"     // Dostęp do htim1, hspi1, GPIO do latcha itd.
+#include "main.h"     // Dostęp do htim3 (latch), hspi1 itd.
 #include "slider.h"
+#include "decfmt.h"
 
 volatile bool spiTransferInProgress = false;  // Flaga transmisji SPI
-static uint8_t spiTxBuffer[24];  // Bufor na 192 bity (24 bajty)
-// static Bits192 regValue;  // Przechowuje 192 bity rozbite na 12×16
-
-// Konwersja znaku na wzór 7-segmentowy
-uint8_t charToSegment(char c) {
-    switch (c) {
-    case '0' ... '9':
-        return segmentMap[c - '0'];
-    case '-':
-        return segmentMap[11];
-    case '*':  // symbol stopnia
-        return segmentMap[12];
-    case 'C':
-        return segmentMap[13];
-    case 'c':
-        return segmentMap[29];
-    case 'r':
-    case 'R':
-        return segmentMap[14];
-    case 'h':
-        return segmentMap[15];
-    case 's':
-    case 'S':
-        return segmentMap[5];
-    case 'F':
-        return segmentMap[16];
-    case 'A':
-    case 'a':
-        return segmentMap[17];
-    case 't':
-    case 'T':
-        return segmentMap[18];
-    case 'V':
-    case 'U':
-    case 'W':
-        return segmentMap[19];
-    case 'n':
-    case 'N':
-        return segmentMap[20];
-    case 'i':
-        return segmentMap[21];
-    case 'E':
-    case 'e':
-        return segmentMap[22];
-    case 'd':
-        return segmentMap[23];
-    case 'P':
-    case 'p':
-        return segmentMap[24];
-    case 'o':
-        return segmentMap[25];
-    case 'O':
-        return segmentMap[0];
-    case 'u':
-    case 'w':
-    case 'v':
-        return segmentMap[26];
-    case 'L':
-        return segmentMap[27];
-    case 'z':
-    case 'Z':
-        return segmentMap[2];
-    case 'b':
-    case 'B':
-        return segmentMap[28];
-    case 'y':
-        return segmentMap[29];
-    case 'H':
-        return segmentMap[30];
-    case 'j':
-    case 'J':
-        return segmentMap[31];
-    default:
-        return segmentMap[10];  // Spacja lub nieobsługiwany znak
+
+/* Ping-pong frame buffers: s_frameBuf[s_txIndex] is on the wire (front),
+   the other one (back) holds the newest frame waiting for the DMA. */
+static DisplayFrame_t s_frameBuf[2];
+static volatile uint8_t s_txIndex = 0;
+static volatile uint8_t s_pending = 0;      // 1 = back buffer holds an unsent frame
+static volatile DisplayStats_t s_stats;
+static volatile bool s_spiReleased = false; // SPI1/TIM3 lent to another engine (BCM)
+
+/* Second-locked frames: the staged frame sits in the chain unlatched,
+   and the normal pipeline holds until the RTC edge latches it */
+static volatile bool     s_staged = false;
+static volatile bool     s_latchOnCplt = false; // Edge came while the staged frame was shifting
+static volatile uint32_t s_edgeCount = 0;
+static uint32_t          s_edgeStamp;           // DWT->CYCCNT at the last edge interrupt entry
+
+/* Dirty-frame tracking: buffer written by the last accepted submit */
+static uint8_t  s_lastQueued = 0;
+static bool     s_haveQueued = false;
+static uint16_t s_unchangedRun = 0;         // Frames skipped since the last transfer
+
+// Word-wise comparison of two frames
+static bool FramesEqual(const DisplayFrame_t* a, const DisplayFrame_t* b)
+{
+    uint32_t diff = 0;
+    for (uint8_t i = 0; i < FRAME_WORDS; i++) {
+        diff |= a->word[i] ^ b->word[i];
     }
+    return (diff == 0U);
 }
 
-/* Implementacja funkcji obsługujących 192-bitowy rejestr wyświetlaczy */
-void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+// Atomically clears the pending flag and returns its previous value
+static uint8_t TakePending(void)
 {
-  if (hspi->Instance == SPI1)
-  {
-    HAL_GPIO_WritePin(SPI1_LATCH_GPIO_Port, SPI1_LATCH_Pin, GPIO_PIN_SET);   // Impuls na LATCH
-    HAL_GPIO_WritePin(SPI1_LATCH_GPIO_Port, SPI1_LATCH_Pin, GPIO_PIN_RESET); // Reset LATCH
-    spiTransferInProgress = false;
-  }
+    uint8_t was;
+    do {
+        was = __LDREXB(&s_pending);
+    } while (__STREXB(0U, &s_pending) != 0U);
+    return was;
 }
 
-void Send192_struct(const Bits192 *data)
+// Starts DMA on the back buffer if a frame is pending; called with SPI1 idle
+static void StartPendingFrame(void)
 {
-  memset(spiTxBuffer, 0, sizeof(spiTxBuffer));  // Wyczyść bufor
-  int byteIndex = 0;
-  for (int partIndex = 11; partIndex >= 0; partIndex--)
-  {
-    uint16_t val = data->part[partIndex];
-    spiTxBuffer[byteIndex++] = (uint8_t)((val >> 8) & 0xFF);  // MSB
-    spiTxBuffer[byteIndex++] = (uint8_t)(val & 0xFF);         // LSB
-  }
-  HAL_SPI_Transmit_DMA(&hspi1, spiTxBuffer, 24);
+    if (s_spiReleased || s_staged || !TakePending()) {
+        spiTransferInProgress = false;
+        return;
+    }
+    s_txIndex ^= 1U;
+    spiTransferInProgress = true;
+
+    /* The previous latch pulse must be over before new bits enter the chain.
+       At most guard + width (~2 us) remain when the SPI callback gets here. */
+    while (TIM3->CR1 & TIM_CR1_CEN) {
+    }
+
+    /* SPI start and latch arm back to back, so the pulse lands at a fixed
+       offset from the first SPI clock no matter what interrupts are pending */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    /* Frame is already in wire order: DMA streams it as-is, 12 x 16-bit */
+    if (HAL_SPI_Transmit_DMA(&hspi1, (uint8_t*)s_frameBuf[s_txIndex].half, FRAME_HALFWORDS) == HAL_OK) {
+        TIM3->CNT = 0U;
+        TIM3->CR1 |= TIM_CR1_CEN;   // One-pulse: latch fires after the last bit, CEN clears itself
+    } else {
+        spiTransferInProgress = false;
+    }
+    __set_PRIMASK(primask);
 }
 
-void ClearClockBits(MyClockBitFields* clockBits)
+/* Sets up the TIM3 CH1 one-pulse latch on SPI1_LATCH (PA6).
+   Counting starts together with the SPI DMA; the output goes high once the
+   192 bits have been clocked out plus DISPLAY_LATCH_GUARD_US and stays high
+   for DISPLAY_LATCH_WIDTH_US. Timing follows the SPI1 prescaler and clocks. */
+void DISPLAY_LatchInit(void)
 {
-  memset(clockBits, 0, sizeof(MyClockBitFields));
+    uint32_t spiDiv = 2UL << ((hspi1.Init.BaudRatePrescaler & SPI_CR1_BR_Msk) >> SPI_CR1_BR_Pos);
+    uint32_t spiClk = HAL_RCC_GetPCLK2Freq();
+    uint32_t timClk = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+        timClk *= 2U;   // APB1 timers run at 2x PCLK1 when APB1 is divided
+    }
+
+    uint32_t shiftTicks = (uint32_t)(((uint64_t)FRAME_BITS * spiDiv * timClk + spiClk - 1U) / spiClk);
+    uint32_t guardTicks = (timClk / 1000000U) * DISPLAY_LATCH_GUARD_US;
+    uint32_t widthTicks = (timClk / 1000000U) * DISPLAY_LATCH_WIDTH_US;
+    uint32_t delay = shiftTicks + guardTicks;
+
+    __HAL_TIM_SET_COMPARE(&htim3, TIM_CHANNEL_1, delay);
+    __HAL_TIM_SET_AUTORELOAD(&htim3, delay + widthTicks);
+    TIM3->EGR = TIM_EGR_UG;      // CCR1 is preloaded: load it now, not after the first pulse
+    TIM3->CNT = 0U;
+    TIM_CCxChannelCmd(TIM3, TIM_CHANNEL_1, TIM_CCx_ENABLE);
+
+    /* Cycle counter for the second-edge latch statistics */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
-void SetSecondLedSingle(MyClockBitFields* clockBits, uint8_t second)
+/* Latch pulse right now: starting the one-pulse counter at CCR1 skips the
+   shift delay, the output goes high at once for DISPLAY_LATCH_WIDTH_US */
+static void FireLatch(void)
 {
-    if (second >= 60) second = 59;
-    clockBits->secondsRing = 0ULL;
-    uint64_t mask = (1ULL << second);
-    clockBits->secondsRing = mask;
+    TIM3->CNT = TIM3->CCR1;
+    TIM3->CR1 |= TIM_CR1_CEN;
+
+    uint32_t cycles = DWT->CYCCNT - s_edgeStamp;
+    s_stats.edgeCyclesLast = cycles;
+    if (cycles > s_stats.edgeCyclesMax) {
+        s_stats.edgeCyclesMax = cycles;
+    }
 }
 
-void SetSecondLedAccumulating(MyClockBitFields* clockBits, uint8_t second)
+/* ASCII -> 7-seg pattern (bit 0 = a ... bit 6 = g, bit 7 = dp), in flash.
+   Characters without a glyph stay 0 (blank). */
+const uint8_t segmentTable[128] = {
+    ['0'] = SEG_GLYPH_0,
+    ['1'] = SEG_GLYPH_1,
+    ['2'] = SEG_GLYPH_2,
+    ['3'] = SEG_GLYPH_3,
+    ['4'] = SEG_GLYPH_4,
+    ['5'] = SEG_GLYPH_5,
+    ['6'] = SEG_GLYPH_6,
+    ['7'] = SEG_GLYPH_7,
+    ['8'] = SEG_GLYPH_8,
+    ['9'] = SEG_GLYPH_9,
+    ['-'] = SEG_MINUS,
+    ['_'] = 0b00001000,
+    ['='] = 0b01001000,
+    ['*'] = 0b01100011,   /* symbol stopnia */
+    ['A'] = 0b01110111, ['a'] = 0b01110111,
+    ['B'] = 0b01111100, ['b'] = 0b01111100,
+    ['C'] = 0b00111001, ['c'] = 0b01011000,
+    ['d'] = 0b01011110,
+    ['E'] = 0b01111001, ['e'] = 0b01111001,
+    ['F'] = 0b01110001,
+    ['G'] = 0b00111101,
+    ['H'] = 0b01110110, ['h'] = 0b01110100,
+    ['I'] = 0b00000110, ['i'] = 0b00010000,
+    ['J'] = 0b00011110, ['j'] = 0b00011110,
+    ['L'] = 0b00111000,
+    ['N'] = 0b01010100, ['n'] = 0b01010100,
+    ['O'] = 0b00111111, ['o'] = 0b01011100,
+    ['P'] = 0b01110011, ['p'] = 0b01110011,
+    ['q'] = 0b01100111,
+    ['R'] = 0b01010000, ['r'] = 0b01010000,
+    ['S'] = 0b01101101, ['s'] = 0b01101101,
+    ['T'] = 0b01111000, ['t'] = 0b01111000,
+    ['U'] = 0b00111110, ['u'] = 0b00011100,
+    ['V'] = 0b00111110, ['v'] = 0b00011100,
+    ['W'] = 0b00111110, ['w'] = 0b00011100,
+    ['Y'] = 0b01101110, ['y'] = 0b01101110,
+    ['Z'] = 0b01011011, ['z'] = 0b01011011,
+};
+
+/* Whole 6-character field in one pass: character i lands in byte i
+   (bottom display order). The string may be shorter; the rest is blank. */
+uint64_t EncodeSegments6(const char* text)
 {
-    if (second >= 60) second = 59;
-    if (second == 0) {
-        clockBits->secondsRing = 0ULL;
-    } else {
-        clockBits->secondsRing |= (1ULL << second);
+    uint64_t word = 0ULL;
+    for (uint8_t i = 0; i < 6U; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (c == 0U) {
+            break;
+        }
+        word |= (uint64_t)charToSegment((char)c) << (8U * i);
     }
+    return word;
 }
 
-void SetSecondLedAccumulating2(MyClockBitFields* clockBits, uint8_t second)
+/* Frame byte of each digit (0 = leftmost) for both displays.
+   Bottom: digit i is field byte i. Top is wired 3,2,1,0,4,5:
+   digits 0..3 run backwards through the low four bytes. */
+#define SEG_TOP_BYTE(n)     FRAME_BYTE_INDEX(FRAME_OFS_TOP_DISPLAY + 8U * (n))
+#define SEG_BOTTOM_BYTE(n)  FRAME_BYTE_INDEX(FRAME_OFS_BOTTOM_DISPLAY + 8U * (n))
+
+static const uint8_t s_digitByte[2][SEG_DIGITS] = {
+    [DISPLAY_TOP]    = { SEG_TOP_BYTE(3), SEG_TOP_BYTE(2), SEG_TOP_BYTE(1),
+                         SEG_TOP_BYTE(0), SEG_TOP_BYTE(4), SEG_TOP_BYTE(5) },
+    [DISPLAY_BOTTOM] = { SEG_BOTTOM_BYTE(0), SEG_BOTTOM_BYTE(1), SEG_BOTTOM_BYTE(2),
+                         SEG_BOTTOM_BYTE(3), SEG_BOTTOM_BYTE(4), SEG_BOTTOM_BYTE(5) },
+};
+
+/* Writes 'count' glyphs starting at digit 'first'; the other digits keep
+   their content. Every digit is one byte of the frame, so each glyph is a
+   single byte store. */
+void Render7SegRange(DisplayFrame_t* frame, SegDisplay_t disp, uint8_t first, uint8_t count, const uint8_t* glyphs)
 {
-    if (second >= 60) second = 59;
-    clockBits->secondsRing = 0ULL;
-    for (uint8_t i = 0; i <= second; i++) {
-        clockBits->secondsRing |= (1ULL << i);
+    const uint8_t* map = s_digitByte[disp];
+    if (first >= SEG_DIGITS) return;
+    if (count > SEG_DIGITS - first) count = SEG_DIGITS - first;
+
+    for (uint8_t i = 0; i < count; i++) {
+        frame->byte[map[first + i]] = glyphs[i];
     }
 }
 
-void SetSecondsDots(MyClockBitFields* clockBits, uint8_t second)
+void Render7Seg(DisplayFrame_t* frame, SegDisplay_t disp, const uint8_t glyphs[SEG_DIGITS])
+{
+    const uint8_t* map = s_digitByte[disp];
+    frame->byte[map[0]] = glyphs[0];
+    frame->byte[map[1]] = glyphs[1];
+    frame->byte[map[2]] = glyphs[2];
+    frame->byte[map[3]] = glyphs[3];
+    frame->byte[map[4]] = glyphs[4];
+    frame->byte[map[5]] = glyphs[5];
+}
+
+// Decimal point of one digit, the glyph itself is left alone
+void Set7SegPoint(DisplayFrame_t* frame, SegDisplay_t disp, uint8_t digit, bool on)
+{
+    if (digit >= SEG_DIGITS) return;
+    uint8_t* b = &frame->byte[s_digitByte[disp][digit]];
+    *b = on ? (uint8_t)(*b | SEG_DP) : (uint8_t)(*b & ~SEG_DP);
+}
+
+/* Implementacja funkcji obsługujących 192-bitowy rejestr wyświetlaczy */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    /* Latch is pulsed by TIM3, armed when this transfer started,
+       except for a staged frame: that one waits for the second edge */
+    s_stats.transmitted++;
+    if (s_latchOnCplt) {
+      s_latchOnCplt = false;
+      FireLatch();
+    }
+    StartPendingFrame();  // Latest frame rendered during the transfer goes out now
+  }
+}
+
+void ClearClockBits(DisplayFrame_t* frame)
+{
+  memset(frame, 0, sizeof(DisplayFrame_t));
+}
+
+void SetSecondsDots(DisplayFrame_t* frame, uint8_t second)
 {
   if (second == 0) {
-    SetDots(clockBits, false, false);
+    SetDots(frame, false, false);
   } else {
-    SetDots(clockBits, true, true);
+    SetDots(frame, true, true);
   }
 }
 
-void SetHourRing(MyClockBitFields* clockBits, uint8_t hour, bool outerRing, bool innerRing)
+void SetHourRing(DisplayFrame_t* frame, uint8_t hour, bool outerRing, bool innerRing)
 {
   uint8_t h12 = hour % 12;
-  clockBits->hoursRingOuter = outerRing ? (1U << h12) : 0;
-  clockBits->hoursRingInner = innerRing ? (1U << h12) : 0;
+  WriteFrameBits(frame, FRAME_OFS_HOURS_OUTER, FRAME_LEN_HOURS_OUTER, outerRing ? (1U << h12) : 0);
+  WriteFrameBits(frame, FRAME_OFS_HOURS_INNER, FRAME_LEN_HOURS_INNER, innerRing ? (1U << h12) : 0);
 }
 
-void SetHoursRing(MyClockBitFields* clockBits, uint8_t hour)
+void SetHoursRing(DisplayFrame_t* frame, uint8_t hour)
 {
   uint8_t h12 = hour % 12;
-  clockBits->hoursRingOuter = (1U << h12);
-  clockBits->hoursRingInner = (1U << h12);
+  WriteFrameBits(frame, FRAME_OFS_HOURS_OUTER, FRAME_LEN_HOURS_OUTER, (1U << h12));
+  WriteFrameBits(frame, FRAME_OFS_HOURS_INNER, FRAME_LEN_HOURS_INNER, (1U << h12));
 }
 
 /* Ustawia 6 wyświetlaczy 7-seg (top) na HH:MM:SS */
-void SetTime7Seg_Top(MyClockBitFields* clockBits, uint8_t h, uint8_t m, uint8_t s)
+void SetTime7Seg_Top(DisplayFrame_t* frame, uint8_t h, uint8_t m, uint8_t s)
 {
-    uint8_t backBuffer[6] = {0};  /* Bufor segmentów */
+    uint8_t backBuffer[SEG_DIGITS];  /* Bufor segmentów */
 
-    /* Ustawianie godzin */
+    /* Godziny bez zera wiodącego, minuty i sekundy z parami cyfr */
+    DECFMT_Pair(h, &backBuffer[0]);
     if (h < 10) {
-        backBuffer[0] = segmentMap[10];  /* Puste dziesiątki */
-        backBuffer[1] = charToSegment('0' + h);
-    } else {
-        backBuffer[0] = charToSegment('0' + (h / 10));
-        backBuffer[1] = charToSegment('0' + (h % 10));
+        backBuffer[0] = SEG_BLANK;  /* Puste dziesiątki */
     }
+    DECFMT_Pair(m, &backBuffer[2]);
+    DECFMT_Pair(s, &backBuffer[4]);
 
-    /* Ustawianie minut */
-    backBuffer[2] = charToSegment('0' + (m / 10));
-    backBuffer[3] = charToSegment('0' + (m % 10));
-
-    /* Ustawianie sekund */
-    backBuffer[4] = charToSegment('0' + (s / 10));
-    backBuffer[5] = charToSegment('0' + (s % 10));
-
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)backBuffer[5] << 40);
-    displayVal |= ((uint64_t)backBuffer[4] << 32);
-    displayVal |= ((uint64_t)backBuffer[0] << 24);
-    displayVal |= ((uint64_t)backBuffer[1] << 16);
-    displayVal |= ((uint64_t)backBuffer[2] << 8);
-    displayVal |= ((uint64_t)backBuffer[3] << 0);
-    clockBits->topDisplay = displayVal;
+    Render7Seg(frame, DISPLAY_TOP, backBuffer);
 }
 
-void SetTime7Seg_Void(MyClockBitFields* clockBits)
+/* BCD nibble -> glyph; invalid nibbles blank */
+static const uint8_t s_bcdGlyph[16] = {
+    SEG_GLYPH_0, SEG_GLYPH_1, SEG_GLYPH_2, SEG_GLYPH_3, SEG_GLYPH_4,
+    SEG_GLYPH_5, SEG_GLYPH_6, SEG_GLYPH_7, SEG_GLYPH_8, SEG_GLYPH_9,
+};
+/* Hour tens 0..2, 0 stays dark like in SetTime7Seg_Top */
+static const uint8_t s_hourTensGlyph[4] = { SEG_BLANK, SEG_GLYPH_1, SEG_GLYPH_2, SEG_BLANK };
+
+/* HH:MM:SS on the top display straight from an RTC_TR value (24 h):
+   every digit is a nibble lookup, no arithmetic */
+void SetTime7Seg_TopBCD(DisplayFrame_t* frame, uint32_t rtcTR)
 {
-    uint8_t backBuffer[6] = {0};
-    backBuffer[0] = segmentMap[10];
-    backBuffer[1] = segmentMap[10];
-    backBuffer[2] = segmentMap[10];
-    backBuffer[3] = segmentMap[10];
-    backBuffer[4] = segmentMap[10];
-    backBuffer[5] = segmentMap[10];
-
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)backBuffer[5] << 40);
-    displayVal |= ((uint64_t)backBuffer[4] << 32);
-    displayVal |= ((uint64_t)backBuffer[0] << 24);
-    displayVal |= ((uint64_t)backBuffer[1] << 16);
-    displayVal |= ((uint64_t)backBuffer[2] << 8);
-    displayVal |= ((uint64_t)backBuffer[3] << 0);
-    clockBits->topDisplay = displayVal;
+    uint8_t backBuffer[SEG_DIGITS];
+
+    backBuffer[0] = s_hourTensGlyph[(rtcTR >> 20) & 0x3U];
+    backBuffer[1] = s_bcdGlyph[(rtcTR >> 16) & 0xFU];
+    backBuffer[2] = s_bcdGlyph[(rtcTR >> 12) & 0x7U];
+    backBuffer[3] = s_bcdGlyph[(rtcTR >> 8) & 0xFU];
+    backBuffer[4] = s_bcdGlyph[(rtcTR >> 4) & 0x7U];
+    backBuffer[5] = s_bcdGlyph[rtcTR & 0xFU];
+
+    Render7Seg(frame, DISPLAY_TOP, backBuffer);
 }
 
-void Set7Seg_Bot3(MyClockBitFields* clockBits, uint8_t h, uint8_t m, uint8_t s)
+void SetTime7Seg_Void(DisplayFrame_t* frame)
 {
-    uint8_t backBuffer[6] = {0};
+    static const uint8_t blank[SEG_DIGITS] = {SEG_BLANK, SEG_BLANK, SEG_BLANK, SEG_BLANK, SEG_BLANK, SEG_BLANK};
+    Render7Seg(frame, DISPLAY_TOP, blank);
+}
 
+void Set7Seg_Bot3(DisplayFrame_t* frame, uint8_t h, uint8_t m, uint8_t s)
+{
+    uint8_t backBuffer[SEG_DIGITS];
+
+    DECFMT_Pair(h, &backBuffer[0]);
     if (h < 10) {
-        backBuffer[0] = segmentMap[10];
-        backBuffer[1] = charToSegment('0' + h);
-    } else {
-        backBuffer[0] = charToSegment('0' + (h / 10));
-        backBuffer[1] = charToSegment('0' + (h % 10));
+        backBuffer[0] = SEG_BLANK;
     }
+    DECFMT_Pair(m, &backBuffer[2]);
+    DECFMT_Pair(s, &backBuffer[4]);
 
-    backBuffer[2] = charToSegment('0' + (m / 10));
-    backBuffer[3] = charToSegment('0' + (m % 10));
-
-    backBuffer[4] = charToSegment('0' + (s / 10));
-    backBuffer[5] = charToSegment('0' + (s % 10));
-
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)backBuffer[5] << 40);
-    displayVal |= ((uint64_t)backBuffer[4] << 32);
-    displayVal |= ((uint64_t)backBuffer[3] << 24);
-    displayVal |= ((uint64_t)backBuffer[2] << 16);
-    displayVal |= ((uint64_t)backBuffer[1] << 8);
-    displayVal |= ((uint64_t)backBuffer[0] << 0);
-    clockBits->bottomDisplay = displayVal;
+    Render7Seg(frame, DISPLAY_BOTTOM, backBuffer);
 }
 
-void Set7Seg_DisplayLargeNumber(MyClockBitFields* clockBits, uint64_t number) {
-    uint8_t backBuffer[6] = {0};
+void Set7Seg_DisplayLargeNumber(DisplayFrame_t* frame, uint64_t number) {
+    uint8_t backBuffer[SEG_DIGITS];
 
-    for (int i = 5; i >= 0; i--) {
-        if (number > 0) {
-            backBuffer[i] = charToSegment('0' + (number % 10));
-            number /= 10;
-        } else {
-            backBuffer[i] = segmentMap[10];  /* Puste miejsce */
-        }
+    /* Lowest six digits, leading blanks; no 64-bit division libcall */
+    DECFMT_U64(number, backBuffer, SEG_DIGITS, DECFMT_BLANK_PAD);
+    if (number == 0U) {
+        backBuffer[SEG_DIGITS - 1U] = SEG_BLANK;  /* Puste pole dla zera */
     }
 
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)backBuffer[5] << 40);
-    displayVal |= ((uint64_t)backBuffer[4] << 32);
-    displayVal |= ((uint64_t)backBuffer[3] << 24);
-    displayVal |= ((uint64_t)backBuffer[2] << 16);
-    displayVal |= ((uint64_t)backBuffer[1] << 8);
-    displayVal |= ((uint64_t)backBuffer[0] << 0);
-    clockBits->bottomDisplay = displayVal;
+    Render7Seg(frame, DISPLAY_BOTTOM, backBuffer);
 }
 
-void UpdateAllDisplays(const MyClockBitFields* clockBits)
+/* Queues a frame for SPI1. Latest wins: a frame still waiting for the DMA is
+   replaced, and the SPI completion callback starts the newest one at once.
+   A frame equal to the last queued one is dropped (no transfer, no latch),
+   except every DISPLAY_FORCED_REFRESH_FRAMES to repair any corrupted chain. */
+void UpdateAllDisplays(const DisplayFrame_t* frame)
 {
-    if (spiTransferInProgress) {
-        return;
-    }
+    s_stats.submitted++;
 
-    spiTransferInProgress = true;
-    static uint8_t spiTxBuffer[24];
-    memset(spiTxBuffer, 0, sizeof(spiTxBuffer));
-
-    const uint8_t* p = (const uint8_t*)clockBits;
-    int byteIndex = 0;
-    for (int partIndex = 11; partIndex >= 0; partIndex--)
-    {
-        spiTxBuffer[byteIndex++] = p[2 * partIndex + 1];
-        spiTxBuffer[byteIndex++] = p[2 * partIndex + 0];
+    if (s_haveQueued && FramesEqual(frame, &s_frameBuf[s_lastQueued])) {
+        if (s_unchangedRun < DISPLAY_FORCED_REFRESH_FRAMES) {
+            s_unchangedRun++;
+            s_stats.skipped++;
+            return;
+        }
     }
+    s_unchangedRun = 0;
 
-    HAL_SPI_Transmit_DMA(&hspi1, spiTxBuffer, 24);
+    /* Reclaim the back buffer; the ISR cannot swap it while pending is 0 */
+    if (TakePending()) {
+        s_stats.coalesced++;
+    }
+    __DMB();
+    s_lastQueued = s_txIndex ^ 1U;
+    s_frameBuf[s_lastQueued] = *frame;
+    s_haveQueued = true;
+    __DMB();
+    s_pending = 1U;
+
+    if (!spiTransferInProgress) {
+        StartPendingFrame();
+    }
 }
 
-static const uint8_t gamma_table[101] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 4, 4, 4,
-    5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 11, 11, 12, 13, 13, 14, 15, 16, 16, 17,
-    18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 33, 34, 35, 36, 37,
-    39, 40, 41, 43, 44, 46, 47, 49, 50, 52, 53, 55, 56, 58, 60, 61, 63, 65, 66,
-    68, 70, 72, 74, 75, 77, 79, 81, 83, 85, 87, 89, 91, 94, 96, 98, 100
-};
-
-void SetPWMValue(uint16_t value) {
-  if (value > __HAL_TIM_GET_AUTORELOAD(&htim1)) {
-    value = __HAL_TIM_GET_AUTORELOAD(&htim1);
-  }
-  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, value);
+/* Hands SPI1 and the latch timer over to another engine: the transfer in
+   flight finishes, later frames stay queued (latest wins) until reclaimed */
+void DISPLAY_ReleaseSpi(void)
+{
+    s_spiReleased = true;
+    while (spiTransferInProgress) {
+    }
+    /* A staged frame is dropped: the edge interrupt must not touch TIM3 any more */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    s_staged = false;
+    s_latchOnCplt = false;
+    __set_PRIMASK(primask);
+    while (TIM3->CR1 & TIM_CR1_CEN) {
+    }
 }
 
-void SetPWMPercent(uint8_t percent) {
-  if (percent > 100) {
-    percent = 100;
-  }
-  uint32_t period = __HAL_TIM_GET_AUTORELOAD(&htim1);
-  uint32_t compare_value = (period + 1) - ((period + 1) * percent / 100);
-  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, compare_value);
+/* Takes SPI1 back: restores the latch timing and sends the newest frame,
+   even if it equals the last one queued before the release */
+void DISPLAY_ReclaimSpi(void)
+{
+    DISPLAY_LatchInit();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!s_pending && s_haveQueued) {
+        /* Nothing newer queued: resend the last frame over whatever the
+           other engine left latched */
+        s_lastQueued = s_txIndex ^ 1U;
+        s_frameBuf[s_lastQueued] = s_frameBuf[s_txIndex];
+        s_pending = 1U;
+    }
+    s_unchangedRun = 0;
+    s_spiReleased = false;
+    StartPendingFrame();
+    __set_PRIMASK(primask);
 }
 
-void SetPWMPercentGamma(uint8_t percent) {
-  if (percent > 100) {
-      percent = 100;
-  }
-  uint32_t period = __HAL_TIM_GET_AUTORELOAD(&htim1);
-  uint8_t gamma_percent = gamma_table[percent];
-  uint32_t compare_value = (period + 1) * gamma_percent / 100;
-  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, compare_value);
+uint32_t DISPLAY_EdgeCount(void)
+{
+    return s_edgeCount;
 }
 
-void FadeEffect(void)
+bool DISPLAY_StageFrame(const DisplayFrame_t* frame, uint32_t edge)
 {
-    HAL_Delay(200);  /* Delay 200ms */
-    for (int p = 10; p >= 0; p--) {
-        SetPWMPercentGamma(p);
-        HAL_Delay(50);
-    }
-    for (int p = 0; p <= 100; p++) {
-        SetPWMPercentGamma(p);
-        HAL_Delay(50);
-    }
-    for (int p = 100; p >= 10; p--) {
-        SetPWMPercentGamma(p);
-        HAL_Delay(50);
+    bool staged = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!s_spiReleased && !s_staged && !spiTransferInProgress && edge == s_edgeCount) {
+        /* Anything still queued was rendered for the second that is ending */
+        if (TakePending()) {
+            s_stats.coalesced++;
+        }
+        s_lastQueued = s_txIndex ^ 1U;
+        s_frameBuf[s_lastQueued] = *frame;
+        s_haveQueued = true;
+        s_unchangedRun = 0;
+        s_txIndex = s_lastQueued;
+        spiTransferInProgress = true;
+
+        while (TIM3->CR1 & TIM_CR1_CEN) {   // Previous latch pulse still high
+        }
+        /* Shifted in without arming TIM3: the chain keeps showing the
+           current second until the edge interrupt fires the latch */
+        if (HAL_SPI_Transmit_DMA(&hspi1, (uint8_t*)s_frameBuf[s_txIndex].half, FRAME_HALFWORDS) == HAL_OK) {
+            s_staged = true;
+            staged = true;
+        } else {
+            spiTransferInProgress = false;
+        }
     }
+    __set_PRIMASK(primask);
+    return staged;
 }
 
-void SetSecondLedEvenOdd(MyClockBitFields* clockBits, uint8_t second, uint8_t minute)
+void DISPLAY_LatchStaged(uint32_t entryCycles)
 {
-    if (second >= 60) {
-        second = 59;
+    s_edgeCount++;
+    if (!s_staged) {
+        s_stats.edgeMissed++;
+        return;
     }
-    if ((minute % 2) == 0)
-    {
-        clockBits->secondsRing = 0ULL;
-        for (uint8_t i = 0; i <= second; i++)
-        {
-            clockBits->secondsRing |= (1ULL << i);
-        }
+    s_edgeStamp = entryCycles;
+    if (spiTransferInProgress) {
+        s_latchOnCplt = true;       // Staged too late: latch as soon as the last bit is out
+        s_stats.edgeLate++;
+    } else {
+        FireLatch();
+        s_stats.edgeLatched++;
     }
-    else
-    {
-        clockBits->secondsRing = 0ULL;
-        for (uint8_t i = second + 1; i < 60; i++)
-        {
-            clockBits->secondsRing |= (1ULL << i);
-        }
+    s_staged = false;
+
+    /* Frames queued meanwhile still show the old second */
+    if (TakePending()) {
+        s_stats.coalesced++;
     }
 }
 
-void SetDots(MyClockBitFields* clockBits, bool dot1, bool dot2)
+void DISPLAY_GetStats(DisplayStats_t* stats)
 {
-  uint64_t val = 0ULL;
-  if (dot1) val |= (1ULL << 0);
-  if (dot2) val |= (1ULL << 1);
-  clockBits->dots = val;
+    stats->submitted   = s_stats.submitted;
+    stats->transmitted = s_stats.transmitted;
+    stats->coalesced   = s_stats.coalesced;
+    stats->skipped     = s_stats.skipped;
+    stats->bytesAvoided = s_stats.skipped * sizeof(DisplayFrame_t);
+    stats->edgeLatched = s_stats.edgeLatched;
+    stats->edgeLate    = s_stats.edgeLate;
+    stats->edgeMissed  = s_stats.edgeMissed;
+    stats->edgeCyclesLast = s_stats.edgeCyclesLast;
+    stats->edgeCyclesMax  = s_stats.edgeCyclesMax;
 }
-*/
-void SetDots(MyClockBitFields* clockBits, bool dot1, bool dot2) {
+
+void SetDots(DisplayFrame_t* frame, bool dot1, bool dot2) {
   uint64_t val = 0ULL;
   if (dot1) val |= (1ULL << 0);
   if (dot2) val |= (1ULL << 1);
-  clockBits->dots = val;
-}
-
-void SetHourRingCustom(MyClockBitFields* clockBits, uint8_t outerMode, uint8_t innerMode)
-{
-    uint16_t fullMask = 0x0FFF;   /* Pełny pierścień 12 godzin */
-    uint16_t quarterMask = (1U << 0) | (1U << 3) | (1U << 6) | (1U << 9);  /* Kwadranse */
-
-    switch(outerMode)
-    {
-        case 1:
-            clockBits->hoursRingOuter = fullMask;
-            break;
-        case 2:
-            clockBits->hoursRingOuter = quarterMask;
-            break;
-        default:
-            clockBits->hoursRingOuter = 0;
-            break;
-    }
-
-    switch(innerMode)
-    {
-        case 1:
-            clockBits->hoursRingInner = fullMask;
-            break;
-        case 2:
-            clockBits->hoursRingInner = quarterMask;
-            break;
-        default:
-            clockBits->hoursRingInner = 0;
-            break;
-    }
+  WriteFrameBits(frame, FRAME_OFS_DOTS, FRAME_LEN_DOTS, val);
 }
@@ -0,0 +1,238 @@
+/*
+ * display_bcm.c
+ *
+ *  Binary code modulation engine for the ring LEDs, see display_bcm.h
+ */
+
+#include "display_bcm.h"
+#include "main.h"     // hspi1, htim3 (latch)
+
+/* Two complete slot sequences: the DMA runs one (s_show) while the next
+   commit is rendered into the other */
+static DisplayFrame_t s_seq[2][BCM_MAX_SLOTS];
+static volatile uint8_t s_show = 0;          // Sequence the DMA should (keep) running
+static volatile bool    s_released = false;  // 1 = the other sequence is no longer referenced
+static volatile bool    s_running = false;   // Started and not stopped yet
+static volatile bool    s_failed = false;    // DMA error: streaming stopped, BCM_Stop() still due
+
+static uint8_t  s_bits = 0;
+static uint16_t s_slots = 0;
+static uint16_t s_latchTicks = 0;            // Latch pulse width in TIM3 ticks
+static uint8_t  s_level[BCM_LEDS];
+
+// SPI1 clock divider from an SPI_BAUDRATEPRESCALER_x value
+static uint32_t SpiDivider(uint32_t spiPrescaler)
+{
+    return 2UL << ((spiPrescaler & SPI_CR1_BR_Msk) >> SPI_CR1_BR_Pos);
+}
+
+// TIM3 (APB1 timer) kernel clock
+static uint32_t LatchTimerClock(void)
+{
+    uint32_t timClk = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+        timClk *= 2U;
+    }
+    return timClk;
+}
+
+/* Plane latched in slot 'slot': with j = slot + 1, plane (bits-1-ctz(j)).
+   Plane k lands in 2^k slots, spread evenly (MSB plane every other slot),
+   so no plane is one long on/off block that would flicker. */
+static uint8_t SlotPlane(uint16_t slot)
+{
+    return (uint8_t)(s_bits - 1U - (uint8_t)__builtin_ctz((uint32_t)slot + 1U));
+}
+
+// Builds the whole slot sequence for the current levels over 'base'
+static void RenderSequence(DisplayFrame_t* seq, const DisplayFrame_t* base)
+{
+    DisplayFrame_t plane[BCM_MAX_BITS];
+
+    for (uint8_t k = 0; k < s_bits; k++) {
+        plane[k] = *base;
+        WriteFrameBits(&plane[k], FRAME_OFS_SECONDS_RING, FRAME_LEN_SECONDS_RING, 0ULL);
+        WriteFrameBits(&plane[k], FRAME_OFS_HOURS_OUTER, FRAME_LEN_HOURS_OUTER + FRAME_LEN_HOURS_INNER, 0ULL);
+    }
+    for (uint8_t led = 0; led < BCM_LEDS; led++) {
+        uint8_t level = s_level[led];
+        uint16_t bit = (uint16_t)(1U << (led & 15U));
+        for (uint8_t k = 0; level != 0U; k++, level >>= 1) {
+            if (level & 1U) {
+                plane[k].half[FRAME_HALF_INDEX(led)] |= bit;
+            }
+        }
+    }
+    for (uint16_t slot = 0; slot < s_slots; slot++) {
+        seq[slot] = plane[SlotPlane(slot)];
+    }
+}
+
+/* End of a sequence (either DMA memory): point the buffer that has just
+   finished at the sequence to show next. Once both M0AR and M1AR hold it,
+   the other sequence is free for the next commit. */
+static void BCM_DmaCplt(DMA_HandleTypeDef* hdma)
+{
+    DMA_Stream_TypeDef* stream = hdma->Instance;
+    uint32_t next = (uint32_t)s_seq[s_show];
+
+    if (stream->CR & DMA_SxCR_CT) {
+        stream->M0AR = next;     // M1 running, M0 idle
+    } else {
+        stream->M1AR = next;
+    }
+    if ((stream->M0AR == next) && (stream->M1AR == next)) {
+        s_released = true;
+    }
+}
+
+static void BCM_DmaError(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    s_failed = true;             // Stream is disabled by HAL; BCM_Stop() cleans up
+}
+
+uint32_t BCM_RefreshRate_mHz(uint32_t spiPrescaler, uint8_t bits)
+{
+    uint32_t div = SpiDivider(spiPrescaler);
+    if (bits == 0U || bits > BCM_MAX_BITS || div < BCM_MIN_SPI_DIV) {
+        return 0;
+    }
+    uint64_t slotClocks = (uint64_t)FRAME_BITS * div * ((1UL << bits) - 1U);
+    return (uint32_t)(((uint64_t)HAL_RCC_GetPCLK2Freq() * 1000U) / slotClocks);
+}
+
+bool BCM_Start(uint8_t bits, const DisplayFrame_t* base)
+{
+    if (s_running || bits == 0U || bits > BCM_MAX_BITS) {
+        return false;
+    }
+
+    /* One slot = 192 SPI bits; TIM3 must count it exactly, or the latch
+       would drift against the SPI stream */
+    uint32_t div = SpiDivider(hspi1.Init.BaudRatePrescaler);
+    uint32_t spiClk = HAL_RCC_GetPCLK2Freq();
+    uint64_t slotScaled = (uint64_t)FRAME_BITS * div * LatchTimerClock();
+    if (div < BCM_MIN_SPI_DIV || (slotScaled % spiClk) != 0U || (slotScaled / spiClk) > 65536U) {
+        return false;
+    }
+    uint32_t slotTicks = (uint32_t)(slotScaled / spiClk);
+    uint32_t bitTicks = slotTicks / FRAME_BITS;
+
+    DISPLAY_ReleaseSpi();
+
+    s_bits = bits;
+    s_slots = (uint16_t)((1U << bits) - 1U);
+    BCM_ClearLevels();
+    RenderSequence(s_seq[0], base);
+    s_show = 0;
+    s_released = true;
+
+    /* Latch: PWM1, high for half a bit at the start of every timer period.
+       The counter starts half a pulse in, which centres the pulse on the
+       slot boundary (last SCK rising edge at -0.5 bit, next one at +0.5 bit).
+       The first half pulse at start re-latches the previous frame, which is harmless. */
+    s_latchTicks = (uint16_t)(bitTicks / 2U);
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN | TIM_CR1_OPM);
+    MODIFY_REG(TIM3->CCMR1, TIM_CCMR1_OC1M, TIM_OCMODE_PWM1);
+    __HAL_TIM_SET_COMPARE(&htim3, TIM_CHANNEL_1, s_latchTicks);
+    __HAL_TIM_SET_AUTORELOAD(&htim3, slotTicks - 1U);
+    TIM3->EGR = TIM_EGR_UG;      // Load the preloaded CCR1 now
+    int32_t cnt = (int32_t)(s_latchTicks / 2U) - BCM_LATCH_PHASE_TICKS;
+    TIM3->CNT = (uint32_t)((cnt < 0) ? (cnt + (int32_t)slotTicks) : cnt);
+
+    /* Gapless stream: the SPI stream must never wait for the DMA */
+    DMA_HandleTypeDef* hdma = hspi1.hdmatx;
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_PL, DMA_PRIORITY_VERY_HIGH);
+    hdma->XferCpltCallback = BCM_DmaCplt;
+    hdma->XferM1CpltCallback = BCM_DmaCplt;
+    hdma->XferHalfCpltCallback = NULL;
+    hdma->XferM1HalfCpltCallback = NULL;
+    hdma->XferErrorCallback = BCM_DmaError;
+    if (HAL_DMAEx_MultiBufferStart_IT(hdma, (uint32_t)s_seq[0], (uint32_t)&hspi1.Instance->DR,
+                                      (uint32_t)s_seq[0], (uint32_t)s_slots * FRAME_HALFWORDS) != HAL_OK) {
+        MODIFY_REG(hdma->Instance->CR, DMA_SxCR_PL, hdma->Init.Priority);
+        SET_BIT(TIM3->CR1, TIM_CR1_OPM);
+        MODIFY_REG(TIM3->CCMR1, TIM_CCMR1_OC1M, TIM_OCMODE_PWM2);
+        DISPLAY_ReclaimSpi();
+        return false;
+    }
+
+    /* SPI and latch timer start back to back, like a normal frame */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    __HAL_SPI_ENABLE(&hspi1);
+    SET_BIT(hspi1.Instance->CR2, SPI_CR2_TXDMAEN);
+    TIM3->CR1 |= TIM_CR1_CEN;
+    __set_PRIMASK(primask);
+
+    s_failed = false;
+    s_running = true;
+    return true;
+}
+
+void BCM_Stop(void)
+{
+    if (!s_running) {
+        return;
+    }
+
+    /* Never stop in the middle of a latch pulse: the chain would stay transparent */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    while (TIM3->CNT < s_latchTicks) {
+    }
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN);
+    __set_PRIMASK(primask);
+
+    /* The partly shifted slot is never latched; the frame pipeline overwrites it */
+    DMA_HandleTypeDef* hdma = hspi1.hdmatx;
+    HAL_DMA_Abort(hdma);
+    while (!(hspi1.Instance->SR & SPI_SR_TXE) || (hspi1.Instance->SR & SPI_SR_BSY)) {
+    }
+    CLEAR_BIT(hspi1.Instance->CR2, SPI_CR2_TXDMAEN);
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_PL, hdma->Init.Priority);
+
+    SET_BIT(TIM3->CR1, TIM_CR1_OPM);
+    MODIFY_REG(TIM3->CCMR1, TIM_CCMR1_OC1M, TIM_OCMODE_PWM2);
+
+    s_running = false;
+    s_failed = false;
+    DISPLAY_ReclaimSpi();
+}
+
+bool BCM_IsRunning(void)
+{
+    return s_running && !s_failed;
+}
+
+void BCM_SetLevel(uint8_t led, uint8_t level)
+{
+    if (led >= BCM_LEDS) return;
+    uint8_t max = (uint8_t)((1U << s_bits) - 1U);
+    s_level[led] = (level > max) ? max : level;
+}
+
+void BCM_ClearLevels(void)
+{
+    memset(s_level, 0, sizeof(s_level));
+}
+
+bool BCM_Commit(const DisplayFrame_t* base)
+{
+    if (!BCM_IsRunning() || !s_released) {
+        return false;
+    }
+    uint8_t idx = s_show ^ 1U;
+    RenderSequence(s_seq[idx], base);
+    __DMB();
+
+    /* Both together, or the DMA callback could see the old s_show with
+       s_released cleared and release the buffer just handed over */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    s_released = false;
+    s_show = idx;
+    __set_PRIMASK(primask);
+    return true;
+}
@@ -14,6 +14,10 @@
 #include "usart.h"
 #include "rtc.h"
 #include "main.h"
+#include "sched.h"
+#include "timesync.h"
+#include "pps.h"
+#include "tim.h"
 
 uint8_t DOW;                      // Global day-of-week variable
 volatile uint8_t colon = 0;       // Global colon flag
@@ -22,125 +26,238 @@ extern DMA_HandleTypeDef hdma_usart1_rx;  // DMA handle for USART1 RX
 uint8_t gps_dma_buffer[GPS_DMA_BUFFER_SIZE];  // DMA buffer for GPS data
 gps_data_t gps_data = {0};        // Global GPS data structure
 static uint16_t old_pos = 0;      // Previous buffer position
+static GPS_RxStats_t s_rxStats;
+static volatile uint8_t s_rxGeneration = 0;   // Bumped on every (re)start of the DMA
+static NMEA_Parser_t s_nmea;
+static RTC_Raw_t s_parseRtc;              // RTC when the DMA was at s_parsePos
+static uint16_t s_parsePos = 0;
+static uint32_t s_parseUs = 0;            // TIM2 (pps.h time base) at the same moment
+static uint32_t s_parseCycles = 0;        // DWT->CYCCNT at the same moment
+static uint32_t s_nmeaDelayUs = GPS_NMEA_DELAY_MS * 1000U;  // Learned while the PPS is locked
 
-// Returns true if character is a NMEA separator (',' or '*')
-static bool IsNmeaSeparator(char c)
+// UTC in gps_data as one number, to see if this second was already used
+static uint32_t UtcKey(void)
 {
-    return (c == ',' || c == '*');  // Check for comma or asterisk
+    return ((((((uint32_t)gps_data.year * 13U + gps_data.month) * 32U + gps_data.day) * 24U
+              + gps_data.hours) * 60U + gps_data.minutes) * 60U) + gps_data.seconds;
 }
 
-// Parses an unsigned 8-bit integer from a string, up to maxLen digits
-static uint8_t ParseUInt8(const char *startingPtr, uint8_t maxLen)
+// Hands the time in gps_data to the RTC discipline, once per UTC second
+// (RMC and ZDA carry the same time). 'timeField' holds hhmmss.sss of 's'.
+static void DisciplineRtc(const NMEA_Sentence_t* s, uint8_t timeField)
 {
-    uint8_t value = 0;  // Initialize result
-    for (uint8_t i = 0; i < maxLen; i++) {
-        if (startingPtr[i] < '0' || startingPtr[i] > '9')
-            break;  // Stop if non-digit encountered
-        value = (uint8_t)(value * 10 + (startingPtr[i] - '0'));
+    static uint32_t lastKey = UINT32_MAX;
+    uint32_t key = UtcKey();
+    if (key == lastKey)
+        return;
+    lastKey = key;
+
+    /* The sentence ended 'age' bytes before the snapshot (RTC, TIM2). With
+       a locked PPS a whole-second time in it is that of the edge before its end,
+       and edge -> end updates the receiver delay (1/8 per second); otherwise
+       the time is that delay older than the end. */
+    uint32_t tps = hrtc.Init.SynchPrediv + 1U;
+    uint32_t age = (uint32_t)((s_parsePos + GPS_DMA_BUFFER_SIZE - s->end) % GPS_DMA_BUFFER_SIZE);
+    uint32_t ageUs = (uint32_t)(((uint64_t)age * 10U * PPS_TIMER_HZ) / huart1.Init.BaudRate);
+    uint32_t fraction = 0;
+    NMEA_FieldDecimal(s, timeField, 3, &fraction);
+    uint32_t edgeUs;
+    uint32_t refTicks;
+    TSYNC_Source_t source;
+    if (fraction % 1000U == 0U && PPS_Associate(s_parseUs - ageUs, &edgeUs)) {
+        refTicks = (uint32_t)(((uint64_t)(s_parseUs - edgeUs) * tps) / PPS_TIMER_HZ);
+        source = TSYNC_SRC_PPS;
+        int32_t delay = (int32_t)(s_parseUs - ageUs - edgeUs);
+        s_nmeaDelayUs = (uint32_t)((int32_t)s_nmeaDelayUs + (delay - (int32_t)s_nmeaDelayUs) / 8);
+    } else {
+        refTicks = ((fraction % 1000U) * tps) / 1000U
+                 + (uint32_t)(((uint64_t)(s_nmeaDelayUs + ageUs) * tps) / PPS_TIMER_HZ);
+        source = TSYNC_SRC_NMEA;
     }
-    return value;  // Return parsed value
+
+    RTC_TimeTypeDef localTime;
+    RTC_DateTypeDef localDate;
+    ConvertUtcToLocalTime(gps_data.hours, gps_data.minutes, gps_data.seconds,
+                          gps_data.day, gps_data.month, gps_data.year,
+                          &localTime, &localDate);
+    TSYNC_Update(&localTime, &localDate, refTicks, &s_parseRtc, source);
+    colon = 1;
+
+    /* From the last byte of the sentence, 'age' characters before the snapshot */
+    uint32_t ageCycles = (uint32_t)(((uint64_t)age * 10U * SystemCoreClock) / huart1.Init.BaudRate);
+    uint32_t latency = DWT->CYCCNT - (s_parseCycles - ageCycles);
+    s_rxStats.rtcUpdates++;
+    s_rxStats.latencyLast = latency;
+    if (latency > s_rxStats.latencyMax)
+        s_rxStats.latencyMax = latency;
 }
 
-// Parse GPRMC sentence from NMEA and update gps_data fields
-static void ParseGPRMC(const char *nmeaLine)
+// hhmmss[.ss] into gps_data
+static bool ParseTime(const NMEA_Sentence_t* s, uint8_t field)
 {
-    const char *p = nmeaLine;
-    uint8_t fieldIndex = 0;
-    const char *fieldPtr = NULL;
-    for (; *p != '\0'; p++) {
-        if (IsNmeaSeparator(*p) || *p == '\r' || *p == '\n') {
-            if (fieldPtr) {
-                switch(fieldIndex) {
-                    case 1: // TIME (hhmmss.ss)
-                        gps_data.hours   = ParseUInt8(fieldPtr, 2);
-                        gps_data.minutes = ParseUInt8(fieldPtr+2, 2);
-                        gps_data.seconds = ParseUInt8(fieldPtr+4, 2);
-                        break;
-                    case 2: // Fix status
-                        gps_data.fix = *fieldPtr;
-                        break;
-                    case 9: // DATE (ddmmyy)
-                        gps_data.day   = ParseUInt8(fieldPtr, 2);
-                        gps_data.month = ParseUInt8(fieldPtr+2, 2);
-                        gps_data.year  = ParseUInt8(fieldPtr+4, 2);
-                        break;
-                    default:
-                        break;
-                }
-            }
-            fieldPtr = NULL;
-            fieldIndex++;
-        } else {
-            if (!fieldPtr) fieldPtr = p;
-        }
-        if (*p == '*') break;
-    }
+    uint32_t hh, mm, ss;
+    if (!NMEA_FieldDigits(s, field, 0, 2, &hh) || !NMEA_FieldDigits(s, field, 2, 2, &mm) ||
+        !NMEA_FieldDigits(s, field, 4, 2, &ss))
+        return false;
+    gps_data.hours   = (uint8_t)hh;
+    gps_data.minutes = (uint8_t)mm;
+    gps_data.seconds = (uint8_t)ss;
+    return true;
+}
+
+// RMC: $--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,...
+static void HandleRMC(const NMEA_Sentence_t* s)
+{
+    uint32_t dd, mo, yy;
+    gps_data.fix = NMEA_FieldChar(s, 2, 0);
+    if (!NMEA_FieldDigits(s, 9, 0, 2, &dd) || !NMEA_FieldDigits(s, 9, 2, 2, &mo) ||
+        !NMEA_FieldDigits(s, 9, 4, 2, &yy) || !ParseTime(s, 1))
+        return;                       // No time or date yet (receiver starting)
+    gps_data.day   = (uint8_t)dd;
+    gps_data.month = (uint8_t)mo;
+    gps_data.year  = (uint8_t)yy;
+
     // Update RTC immediately if fix is active
-    if (gps_data.fix == 'A') {
-        RTC_TimeTypeDef localTime;
-        RTC_DateTypeDef localDate;
-        ConvertUtcToLocalTime(gps_data.hours, gps_data.minutes, gps_data.seconds,
-                              gps_data.day, gps_data.month, gps_data.year,
-                              &localTime, &localDate);
-        HAL_RTC_SetTime(&hrtc, &localTime, RTC_FORMAT_BIN);
-        HAL_RTC_SetDate(&hrtc, &localDate, RTC_FORMAT_BIN);
-        colon = 1;
+    if (gps_data.fix == 'A')
+        DisciplineRtc(s, 1);
+}
+
+// ZDA: $--ZDA,hhmmss.ss,dd,mm,yyyy,zh,zm - date and time without a status,
+// so only used while RMC or GSA report a fix
+static void HandleZDA(const NMEA_Sentence_t* s)
+{
+    uint32_t dd, mo, yyyy;
+    if (!NMEA_FieldDigits(s, 2, 0, 2, &dd) || !NMEA_FieldDigits(s, 3, 0, 2, &mo) ||
+        !NMEA_FieldDigits(s, 4, 0, 4, &yyyy) || !ParseTime(s, 1))
+        return;
+    gps_data.day   = (uint8_t)dd;
+    gps_data.month = (uint8_t)mo;
+    gps_data.year  = (uint8_t)(yyyy % 100U);
+
+    if (gps_data.fix == 'A' || gps_data.fixMode >= 2U)
+        DisciplineRtc(s, 1);
+}
+
+// GGA: satellites in use (field 7)
+static void HandleGGA(const NMEA_Sentence_t* s)
+{
+    uint32_t satellites;
+    if (NMEA_FieldUInt(s, 7, &satellites)) {
+        gps_data.satellites = (uint8_t)satellites;
     }
 }
 
-// Parse GPGGA sentence from NMEA and update satellites count
-static void ParseGPGGA(const char *nmeaLine)
+// GSA: fix mode (1 none, 2 2D, 3 3D) and HDOP. Multi-constellation
+// receivers send one GN GSA per system; they all carry the same solution.
+static void HandleGSA(const NMEA_Sentence_t* s)
 {
-    const char *p = nmeaLine;      // Pointer for iterating through the sentence
-    uint8_t fieldIndex = 0;        // Current field index
-    const char *fieldPtr = NULL;   // Pointer to the start of the field
-    for (; *p != '\0'; p++) {
-        if (IsNmeaSeparator(*p) || *p == '\r' || *p == '\n') {
-            if (fieldPtr && fieldIndex == 7) {
-                gps_data.satellites = ParseUInt8(fieldPtr, 2);  // Parse satellites count
-            }
-            fieldPtr = NULL;
-            fieldIndex++;
-        } else {
-            if (!fieldPtr)
-                fieldPtr = p;
-        }
-        if (*p == '*')
-            break;
+    uint32_t mode, hdop;
+    if (NMEA_FieldUInt(s, 2, &mode)) {
+        gps_data.fixMode = (uint8_t)mode;
     }
+    if (NMEA_FieldDecimal(s, 16, 1, &hdop)) {
+        gps_data.hdop = (uint16_t)((hdop > UINT16_MAX) ? UINT16_MAX : hdop);
+    }
+}
+
+// GSV: satellites in view, one sequence per talker (GP, GL, GA, GB / BD...)
+static void HandleGSV(const NMEA_Sentence_t* s)
+{
+    static struct { uint16_t talker; uint8_t inView; } systems[GPS_MAX_SYSTEMS];
+    uint32_t msg, inView;
+    if (!NMEA_FieldUInt(s, 2, &msg) || msg != 1U || !NMEA_FieldUInt(s, 3, &inView))
+        return;                       // The count is in every message; the first is enough
+
+    uint8_t i = 0;
+    while (i < GPS_MAX_SYSTEMS && systems[i].talker != 0U && systems[i].talker != s->talker)
+        i++;
+    if (i == GPS_MAX_SYSTEMS)
+        return;
+    systems[i].talker = s->talker;
+    systems[i].inView = (uint8_t)inView;
+
+    uint16_t total = 0;
+    for (i = 0; i < GPS_MAX_SYSTEMS; i++)
+        total += systems[i].inView;
+    gps_data.satsInView = (uint8_t)((total > UINT8_MAX) ? UINT8_MAX : total);
 }
 
-// Process the DMA buffer and parse complete NMEA sentences
+// Feed the new part of the DMA ring to the tokenizer
 void GPS_ProcessBuffer(void)
 {
+    static uint8_t seenGeneration = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();                  // Write position, RTC, TIM2 and DWT at the same instant
+    uint8_t generation = s_rxGeneration;  // With the position: a restart moves both
     uint16_t now_pos = GPS_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&hdma_usart1_rx);  // Current buffer position
-    while (old_pos != now_pos) {
-        char c = (char)gps_dma_buffer[old_pos];
-        static char lineBuf[128];
-        static uint8_t lineIndex = 0;
-        if (lineIndex < sizeof(lineBuf) - 1) {
-            lineBuf[lineIndex++] = c;
-        }
-        if (c == '\n' || c == '\r') {
-            lineBuf[lineIndex] = '\0';
-            if (strncmp(lineBuf, "$GPRMC", 6) == 0) {
-                ParseGPRMC(lineBuf);
-            }
-            if (strncmp(lineBuf, "$GPGGA", 6) == 0) {
-                ParseGPGGA(lineBuf);
-            }
-            if (strncmp(lineBuf, "$GPRMC", 6) == 0 || strncmp(lineBuf, "$GNRMC", 6) == 0) {
-                ParseGPRMC(lineBuf);
-            }
-            else if (strncmp(lineBuf, "$GPGGA", 6) == 0 || strncmp(lineBuf, "$GNGGA", 6) == 0) {
-                ParseGPGGA(lineBuf);
-            }
-            lineIndex = 0;
-        }
-        old_pos++;
-        if (old_pos >= GPS_DMA_BUFFER_SIZE)
-            old_pos = 0;
+    RTC_ReadRaw(&s_parseRtc);
+    s_parseUs = __HAL_TIM_GET_COUNTER(&htim2);
+    s_parseCycles = DWT->CYCCNT;
+    __set_PRIMASK(primask);
+    if (seenGeneration != generation) {
+        /* Reception restarted at the beginning of the ring; the sentence
+           in progress is lost, and the old bytes past now_pos must not be
+           read as new (they hold whole, valid sentences up to 1 s old) */
+        seenGeneration = generation;
+        old_pos = 0;
+        NMEA_Reset(&s_nmea);
+    }
+    if (now_pos >= GPS_DMA_BUFFER_SIZE)
+        now_pos = 0;
+    s_parsePos = now_pos;
+    old_pos = NMEA_Feed(&s_nmea, gps_dma_buffer, GPS_DMA_BUFFER_SIZE, old_pos, now_pos);
+}
+
+bool GPS_GetNmeaStats(uint16_t id, NMEA_TypeStats_t* stats)
+{
+    return NMEA_GetStats(&s_nmea, id, stats);
+}
+
+// IDLE line, DMA half or full: new bytes in the ring, wake the GPS task
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    (void)Size;                       // The position is read from the DMA counter when parsing
+    if (huart->Instance != USART1)
+        return;
+    switch (HAL_UARTEx_GetRxEventType(huart)) {
+        case HAL_UART_RXEVENT_IDLE: s_rxStats.idleEvents++; break;
+        case HAL_UART_RXEVENT_HT:   s_rxStats.halfEvents++; break;
+        default:                    s_rxStats.fullEvents++; break;
     }
+    SCHED_SetEvent(SCHED_EVT_GPS_RX);
+}
+
+// Overrun and DMA errors end the HAL reception: start it again. Noise or a
+// framing error alone leaves the circular DMA running; the NMEA checksum
+// drops the sentence with the bad byte.
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance != USART1)
+        return;
+    s_rxStats.errors++;
+    if ((huart->ErrorCode & (HAL_UART_ERROR_ORE | HAL_UART_ERROR_DMA)) == 0U &&
+        huart->RxState != HAL_UART_STATE_READY)
+        return;
+    s_rxStats.restarts++;
+    GPS_StartReception();
+}
+
+HAL_StatusTypeDef GPS_StartReception(void)
+{
+    HAL_UART_AbortReceive(&huart1);
+    s_rxGeneration++;                 // The DMA starts again at the ring start
+    /* HT stays enabled (HAL default for ReceiveToIdle): one event per half */
+    return HAL_UARTEx_ReceiveToIdle_DMA(&huart1, gps_dma_buffer, GPS_DMA_BUFFER_SIZE);
+}
+
+void GPS_GetRxStats(GPS_RxStats_t* stats)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_rxStats;
+    __set_PRIMASK(primask);
+    stats->nmeaDelayUs = s_nmeaDelayUs;
 }
 
 void GPS_Init(void)
@@ -148,6 +265,12 @@ void GPS_Init(void)
     memset(&gps_data, 0, sizeof(gps_data));
     memset(gps_dma_buffer, 0, GPS_DMA_BUFFER_SIZE);
     old_pos = 0;
+    NMEA_Init(&s_nmea);
+    NMEA_Register(&s_nmea, NMEA_ID('R','M','C'), HandleRMC);
+    NMEA_Register(&s_nmea, NMEA_ID('G','G','A'), HandleGGA);
+    NMEA_Register(&s_nmea, NMEA_ID('Z','D','A'), HandleZDA);
+    NMEA_Register(&s_nmea, NMEA_ID('G','S','A'), HandleGSA);
+    NMEA_Register(&s_nmea, NMEA_ID('G','S','V'), HandleGSV);
 }
 
 void ConvertUtcToLocalTime(uint8_t utcHours, uint8_t utcMinutes,
@@ -0,0 +1,86 @@
+/*
+ * input.c
+ *
+ *  Input event ring, see input.h
+ */
+
+#include "input.h"
+#include "sched.h"
+#include "main.h"
+
+static INPUT_Event_t s_ring[INPUT_QUEUE_LEN];
+static volatile uint8_t s_head = 0;     // Written by the producer only
+static volatile uint8_t s_tail = 0;     // Written by INPUT_Pop() only
+static int16_t s_encoderCarry = 0;      // Steps not yet queued (producer)
+static INPUT_Stats_t s_stats;
+
+static bool Put(INPUT_EventType_t type, uint8_t source, int16_t value)
+{
+    uint8_t head = s_head;
+    uint8_t used = (uint8_t)(head - s_tail);
+    if (used >= INPUT_QUEUE_LEN) {
+        return false;
+    }
+    s_ring[head & (INPUT_QUEUE_LEN - 1U)] = (INPUT_Event_t){
+        .time = HAL_GetTick(), .type = (uint8_t)type, .source = source, .value = value
+    };
+    __DMB();                            // Event before the index that publishes it
+    s_head = (uint8_t)(head + 1U);
+
+    s_stats.pushed++;
+    if (used + 1U > s_stats.highWater) s_stats.highWater = (uint8_t)(used + 1U);
+    SCHED_SetEvent(SCHED_EVT_INPUT);
+    return true;
+}
+
+bool INPUT_Push(INPUT_EventType_t type, uint8_t source, int16_t value)
+{
+    if (type == INPUT_EVT_ENCODER) {
+        int32_t steps = (int32_t)value + s_encoderCarry;
+        if (steps > INT16_MAX) steps = INT16_MAX;
+        if (steps < INT16_MIN) steps = INT16_MIN;
+        value = (int16_t)steps;
+        s_encoderCarry = 0;
+    } else {
+        INPUT_Flush();                  // Keep carried steps ahead of a later press
+    }
+
+    if (Put(type, source, value)) {
+        return true;
+    }
+    if (type == INPUT_EVT_ENCODER) {
+        s_encoderCarry = value;
+        s_stats.carried++;
+    } else {
+        s_stats.dropped++;
+    }
+    return false;
+}
+
+void INPUT_Flush(void)
+{
+    if (s_encoderCarry != 0 && Put(INPUT_EVT_ENCODER, 0, s_encoderCarry)) {
+        s_encoderCarry = 0;
+    }
+}
+
+bool INPUT_Pop(INPUT_Event_t* event)
+{
+    uint8_t tail = s_tail;
+    if (tail == s_head) {
+        return false;
+    }
+    __DMB();                            // Index before the event it publishes
+    *event = s_ring[tail & (INPUT_QUEUE_LEN - 1U)];
+    __DMB();                            // Copy out before the slot is freed
+    s_tail = (uint8_t)(tail + 1U);
+    return true;
+}
+
+void INPUT_GetStats(INPUT_Stats_t* stats)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_stats;
+    __set_PRIMASK(primask);
+}
@@ -29,19 +29,25 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "display.h"   /* Biblioteka wyświetlacza */
+#include "brightness.h" /* Jasność i efekty PWM (TIM1 + DMA) */
+#include "ambient.h"    /* Czujnik światła, automatyczna jasność */
 #include "button.h"    /* Obsługa przycisków */
 #include "gps_parser.h"
 #include "slider.h"    /* Obsługa przewijania tekstu */
 #include "sht30.h"     /* Czujnik temperatury i wilgotności */
 #include "menu.h"      /* Moduł menu */
+#include "sched.h"     /* Planista zadań */
+#include "input.h"     /* Kolejka zdarzeń enkodera i przycisków */
+#include "compositor.h" /* Warstwy ramki wyświetlacza */
+#include "timesync.h"   /* Dyscyplina RTC z czasu GPS */
+#include "pps.h"        /* Wejście 1PPS z GPS (TIM2 CH1) */
 /* USER CODE END Includes */
 
 /* USER CODE BEGIN PV */
 /* Globalne zmienne systemowe */
-MyClockBitFields clockReg = { 0 };
 RTC_TimeTypeDef sTime;
 RTC_DateTypeDef sDate;
-uint32_t adcValue = 0;
+RTC_Raw_t rtcRaw;
 volatile int32_t encoderValue = 0;
 volatile uint32_t systemTicks = 0;
 /* USER CODE END PV */
@@ -54,6 +60,37 @@ void Get_RTC_Time(void);  /* Odczytuje czas z RTC */
 /* USER CODE END PFP */
 
 /* USER CODE BEGIN 0 */
+/* Zadania planisty, w kolejności priorytetu */
+static void Task_Tick(void)
+{
+  Button_Tick10ms();          /* SHT30, slider, dwukropek */
+}
+
+static void Task_Input(void)
+{
+  INPUT_Event_t event;
+  while (INPUT_Pop(&event))
+  {
+    Button_DispatchEvent(&event);
+  }
+}
+
+static void Task_Display(void)
+{
+  Get_RTC_Time();             /* Odczyt RTC */
+  Display();                  /* Obertas Egzekutas */
+  Display_StageNextSecond();  /* Następna sekunda, zatrzaskiwana na zboczu RTC */
+}
+
+static void Task_Gps(void)
+{
+  GPS_ProcessBuffer();
+}
+
+static void Task_Ambient(void)
+{
+  AMBIENT_Process();          /* Automatyczna jasność */
+}
 /* USER CODE END 0 */
 
 /**
@@ -87,6 +124,7 @@ int main(void)
   MX_DMA_Init();
   MX_SPI1_Init();
   MX_TIM1_Init();
+  MX_TIM3_Init();
   MX_RTC_Init();
   MX_I2C2_Init();
   MX_ADC1_Init();
@@ -94,21 +132,32 @@ int main(void)
   MX_TIM5_Init();
   MX_USART1_UART_Init();
   MX_SPI2_Init();
+  MX_TIM2_Init();
 
   /* USER CODE BEGIN 2 */
   HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_1);
   __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, (htim1.Init.Period + 1) / 2);
 
   SetPWMPercentGamma(30);
-  ClearClockBits(&clockReg);
-  UpdateAllDisplays(&clockReg);
+  AMBIENT_Start();        /* ADC1 wyzwalany z TIM5 CC1, DMA */
+  DISPLAY_LatchInit();
+  COMP_Init();            /* Warstwy wyświetlacza, wszystkie puste */
+  DisplayFrame_t blank;
+  COMP_Commit(&blank);
+  UpdateAllDisplays(&blank);
   SLIDER_Init();
   SHT30_Init();
   //Set_RTC_Time();
   HAL_TIM_Encoder_Start_IT(&htim4, TIM_CHANNEL_ALL);
   HAL_TIM_Base_Start_IT(&htim5);
+  TSYNC_Init();           /* Kalibracja RTC z domeny backup */
+  PPS_Init();
+  if (HAL_TIM_IC_Start_IT(&htim2, TIM_CHANNEL_1) != HAL_OK)   /* Zbocza PPS */
+  {
+    Error_Handler();
+  }
   GPS_Init();
-  if (HAL_UART_Receive_DMA(&huart1, gps_dma_buffer, GPS_DMA_BUFFER_SIZE) != HAL_OK)
+  if (GPS_StartReception() != HAL_OK)   /* DMA + IDLE, zdarzenia SCHED_EVT_GPS_RX */
   {
     Error_Handler();
   }
@@ -117,21 +166,20 @@ int main(void)
   Button_RegisterPressCallback(0, Button1_Pressed);
   Button_RegisterDoubleClickCallback(0, Button1_DoubleClicked);
   Button_RegisterHoldCallback(0, Button1_Held);
+
+  SCHED_AddTask("tick", Task_Tick, 10, 10, 0);
+  SCHED_AddTask("input", Task_Input, 0, 10, SCHED_EVT_INPUT);
+  /* Zdarzenia IDLE / HT / TC z USART1: zdanie NMEA parsowane zaraz po ostatnim bajcie */
+  SCHED_AddTask("gps", Task_Gps, 0, 5, SCHED_EVT_GPS_RX);
+  /* Okno przygotowania następnej sekundy (STAGE_LEAD_MS) mieści 3 okresy po 10 ms */
+  SCHED_AddTask("display", Task_Display, 10, 10, SCHED_EVT_RTC_SECOND);
+  SCHED_AddTask("ambient", Task_Ambient, 0, 100, SCHED_EVT_AMBIENT);
   /* USER CODE END 2 */
 
   /* USER CODE BEGIN WHILE */
+  SCHED_Run();          /* Nie wraca; WFI gdy nic nie jest gotowe */
   while (1)
   {
-    GPS_ProcessBuffer();  /* Przetwarzanie danych GPS */
-    Get_RTC_Time();       /* Odczyt RTC */
-    Display();            /* Obertas Egzekutas */
-
-    if (HAL_ADC_Start(&hadc1) != HAL_OK)
-    {
-      Error_Handler();
-    }
-    Button_Process();     /* Przetwarzanie stanów przycisków */
-    HAL_Delay(10);
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -200,16 +248,20 @@ void Set_RTC_Time(void)
 
 void Get_RTC_Time(void)
 {
-  HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
-  HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+  RTC_ReadRaw(&rtcRaw);
+  RTC_RawToTime(&rtcRaw, &sTime, &sDate);
 }
 
 void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
 {
-  if (htim->Instance == TIM4)
+  if (htim->Instance == TIM2)
+  {
+    PPS_Capture(HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1));   /* Początek sekundy UTC */
+  }
+  else if (htim->Instance == TIM4)
   {
     int8_t direction = __HAL_TIM_IS_TIM_COUNTING_DOWN(htim) ? -1 : +1;
-    Encoder_HandleInterrupt(direction);
+    INPUT_Push(INPUT_EVT_ENCODER, 0, direction);   /* Menu w kontekście głównym */
     if (direction < 0)
       encoderValue--;
     else
@@ -14,7 +14,10 @@
 #include "slider.h"
 #include "display.h"
 #include "button.h"    // for registering encoder callbacks
-#include "main.h"      // for clockReg, etc.
+#include "main.h"
+#include "compositor.h"
+#include "rings.h"
+#include "display_bcm.h"
 #include <string.h>
 #include <stdio.h>
 #include "sht30.h"
@@ -22,8 +25,8 @@
 #include "stm32f4xx_hal_rtc.h"
 
 static const uint8_t s_menuMaxModes[MENU_ITEM_COUNT] = {
-    [MENU_ITEM_HOUR] = 4,
-    [MENU_ITEM_SECD] = 3,
+    [MENU_ITEM_HOUR] = RING_HOURS_MODE_COUNT - 1,
+    [MENU_ITEM_SECD] = RING_SECONDS_MODE_COUNT - 1,
     [MENU_ITEM_COLN] = 3,
     [MENU_ITEM_TOP]  = 5,
     [MENU_ITEM_CUST] = 9,
@@ -142,8 +145,9 @@ uint8_t MENU_GetMode(MenuItem_t item)
     return s_menuModes[item];
 }
 
-// Encoder callback: adjust the mode for the current menu item based on direction
-void MENU_OnEncoderRotate(int8_t direction)
+// Encoder callback: move the mode of the current menu item by 'steps'
+// (several at once when input.h merged them), clamped to 0..max
+void MENU_OnEncoderRotate(int8_t steps)
 {
     if (!s_menuActive)
     {
@@ -153,115 +157,327 @@ void MENU_OnEncoderRotate(int8_t direction)
     {
         return;
     }
-    uint8_t maxVal = s_menuMaxModes[s_currentItem];
-    if (direction > 0)
-    {
-        if (s_menuModes[s_currentItem] < maxVal)
-            s_menuModes[s_currentItem]++;
-    }
-    else
-    {
-        if (s_menuModes[s_currentItem] > 0)
-            s_menuModes[s_currentItem]--;
-    }
+    int16_t mode = (int16_t)s_menuModes[s_currentItem] + steps;
+    if (mode < 0)
+        mode = 0;
+    if (mode > s_menuMaxModes[s_currentItem])
+        mode = s_menuMaxModes[s_currentItem];
+    s_menuModes[s_currentItem] = (uint8_t)mode;
     if (s_currentItem != MENU_ITEM_END)
     {
         MENU_ShowCurrent();
     }
 }
 
-// Display function called in the main loop to update hardware based on menu settings
-void Display(void){
-    uint8_t hourMode = MENU_GetMode(MENU_ITEM_HOUR);
-    uint8_t secdMode = MENU_GetMode(MENU_ITEM_SECD);
-    uint8_t colonMode = MENU_GetMode(MENU_ITEM_COLN);
-    uint8_t topMode = MENU_GetMode(MENU_ITEM_TOP);
-    uint8_t custMode = MENU_GetMode(MENU_ITEM_CUST);
-
-    // Update hours ring based on hourMode
-    switch (hourMode) {
-    case 0: /* ring OFF */
-        SetHourRingCustom(&clockReg, 1, 1);
-        break;
-    case 1:
-        SetHourRingCustom(&clockReg, 0, 1);
-        break;
-    case 2:
-        SetHourRingCustom(&clockReg, 1, 0);
-        break;
-    case 3:
-        SetHourRingCustom(&clockReg, 0, 0);
-        break;
-    case 4: /* additional mode */
-        // ...
-        break;
-    }
+static uint32_t s_layerRenders = 0;   // Face layers actually redrawn
 
-    // Update seconds ring based on secdMode
-    switch (secdMode) {
+/* Face layers. Each renderer keeps the inputs its layer was last drawn
+   from and only opens the layer when one of them changed; otherwise the
+   compositor reuses the layer as it is. */
+
+// Top display content for RTC_TR 'tr' (mode as in MENU_ITEM_TOP)
+static void DrawTop(DisplayFrame_t* layer, uint8_t mode, uint32_t tr)
+{
+    switch (mode) {
     case 0:
-        SetSecondLedSingle(&clockReg, sTime.Seconds);
+        SetTime7Seg_TopBCD(layer, tr);
         break;
     case 1:
-        SetSecondLedAccumulating(&clockReg, sTime.Seconds);
-        break;
-    case 2:
-        SetSecondLedAccumulating2(&clockReg, sTime.Seconds);
-        break;
-    case 3:
-        SetSecondLedEvenOdd(&clockReg, sTime.Seconds, sTime.Minutes);
-        break;
-    case 4: /* additional mode */
-        // ...
+        SetTime7Seg_Void(layer);
         break;
+    // additional cases can be added
     }
+}
+
+static void RenderSeconds(uint8_t mode, uint8_t second, uint8_t minute)
+{
+    static uint32_t s_key = 0xFFFFFFFFU;
+    uint32_t key = ((uint32_t)mode << 16) | ((uint32_t)minute << 8) | second;
+    if (key == s_key) return;
+    s_key = key;
 
-    // Update colon display based on colonMode
-    switch (colonMode) {
+    s_layerRenders++;
+    RING_DrawSeconds(COMP_BeginWrite(COMP_LAYER_SECONDS), mode, second, minute);
+    COMP_EndWrite(COMP_LAYER_SECONDS);
+}
+
+static void RenderHours(uint8_t mode, uint8_t hour)
+{
+    static uint16_t s_key = 0xFFFFU;
+    uint16_t key = (uint16_t)((mode << 8) | hour);
+    if (key == s_key) return;
+    s_key = key;
+
+    s_layerRenders++;
+    RING_DrawHours(COMP_BeginWrite(COMP_LAYER_HOURS), mode, hour);
+    COMP_EndWrite(COMP_LAYER_HOURS);
+}
+
+static void RenderDots(uint8_t mode, bool on)
+{
+    static uint8_t s_key = 0xFFU;
+    uint8_t key = (uint8_t)((mode << 1) | (on ? 1U : 0U));
+    if (key == s_key) return;
+    s_key = key;
+
+    s_layerRenders++;
+    DisplayFrame_t* layer = COMP_BeginWrite(COMP_LAYER_DOTS);
+    switch (mode) {
     case 0:
-        SetDots(&clockReg, colon, colon);
+        SetDots(layer, on, on);
         break;
     case 1:
-        SetDots(&clockReg, 0, colon);
+        SetDots(layer, 0, on);
         break;
     case 2:
-        SetDots(&clockReg, colon, 0);
+        SetDots(layer, on, 0);
         break;
     case 3:
-        SetDots(&clockReg, 0, 0);
+        SetDots(layer, 0, 0);
         break;
     case 4: /* additional mode */
         // ...
         break;
     }
+    COMP_EndWrite(COMP_LAYER_DOTS);
+}
 
-    // Update top 7-seg display based on topMode
-    switch (topMode) {
-    case 0:
-        SetTime7Seg_Top(&clockReg, sTime.Hours, sTime.Minutes, sTime.Seconds);
-        break;
-    case 1:
-        SetTime7Seg_Void(&clockReg);
-        break;
-    // additional cases can be added
+static void RenderTop(uint8_t mode, uint32_t tr)
+{
+    static uint8_t  s_mode = 0xFFU;
+    static uint32_t s_tr = 0xFFFFFFFFU;
+    if (mode == s_mode && tr == s_tr) return;
+    s_mode = mode;
+    s_tr = tr;
+
+    s_layerRenders++;
+    DrawTop(COMP_BeginWrite(COMP_LAYER_TOP), mode, tr);
+    COMP_EndWrite(COMP_LAYER_TOP);
+}
+
+/* Menu focus: while the menu is open the overlay blanks (AND-NOT) every
+   face field except the one the current item sets. The bottom display
+   carries the menu text and is never blanked; CUST and END have no field
+   of their own, so the rest of the face goes dark for them. */
+static DisplayFrame_t s_menuBlank;    // Bits the overlay blanks now, zero when closed
+
+static void RenderMenuOverlay(bool active, uint8_t item)
+{
+    static const struct { uint8_t item, ofs, len; } s_fields[] = {
+        { MENU_ITEM_SECD, FRAME_OFS_SECONDS_RING, FRAME_LEN_SECONDS_RING },
+        { MENU_ITEM_HOUR, FRAME_OFS_HOURS_OUTER,  FRAME_LEN_HOURS_OUTER + FRAME_LEN_HOURS_INNER },
+        { MENU_ITEM_COLN, FRAME_OFS_DOTS,         FRAME_LEN_DOTS },
+        { MENU_ITEM_TOP,  FRAME_OFS_TOP_DISPLAY,  FRAME_LEN_TOP_DISPLAY },
+    };
+    static uint8_t s_key = 0xFFU;
+    uint8_t key = active ? item : MENU_ITEM_COUNT;
+    if (key == s_key) return;
+    s_key = key;
+
+    memset(&s_menuBlank, 0, sizeof(s_menuBlank));
+    if (!active) {
+        COMP_SetEnabled(COMP_LAYER_OVERLAY, false);
+        return;
     }
+    for (uint8_t i = 0; i < sizeof(s_fields) / sizeof(s_fields[0]); i++) {
+        if (s_fields[i].item != item) {
+            WriteFrameBits(&s_menuBlank, s_fields[i].ofs, s_fields[i].len, (1ULL << s_fields[i].len) - 1U);
+        }
+    }
+    memset(COMP_BeginWrite(COMP_LAYER_OVERLAY), 0xFF, sizeof(DisplayFrame_t));
+    COMP_EndWrite(COMP_LAYER_OVERLAY);
+    COMP_SetMask(COMP_LAYER_OVERLAY, &s_menuBlank);
+    COMP_SetBlend(COMP_LAYER_OVERLAY, COMP_BLEND_ANDNOT);
+    COMP_SetEnabled(COMP_LAYER_OVERLAY, true);
+}
+
+/* Everything the face and the sensor readout are rendered from. While it
+   stays the same (most 10 ms passes: same second, no menu or sensor
+   change) Display() renders nothing and only commits the cached layers. */
+typedef struct
+{
+    uint32_t tr;        // RTC_TR: hours, minutes, seconds
+    uint32_t modes;     // 4 bits per menu item
+    int32_t  sensor;    // Reading the slider shows, if valid
+    uint8_t  flags;     // RENDER_F_*
+} RenderKey_t;
+
+#define RENDER_F_COLON          0x01U
+#define RENDER_F_MENU           0x02U
+#define RENDER_F_DISP_MODE      0x04U
+#define RENDER_F_SENSOR_VALID   0x08U
+#define RENDER_F_SLIDER_STOPPED 0x10U
+
+static DisplayRenderStats_t s_renderStats;
+
+static void MakeRenderKey(RenderKey_t* key, SHT30_Data_t* data)
+{
+    memset(key, 0, sizeof(*key));     // Padding too, the key is compared with memcmp
+    key->tr = rtcRaw.tr;
+    for (uint8_t i = 0; i < MENU_ITEM_COUNT; i++) {
+        key->modes |= (uint32_t)(s_menuModes[i] & 0x0FU) << (4U * i);
+    }
+    if (SHT30_GetLatestData(data)) {
+        key->flags |= RENDER_F_SENSOR_VALID;
+        key->sensor = disp_mode ? data->temperature : (int32_t)data->humidity;
+    }
+    if (colon)               key->flags |= RENDER_F_COLON;
+    if (MENU_IsActive())     key->flags |= RENDER_F_MENU;
+    if (disp_mode)           key->flags |= RENDER_F_DISP_MODE;
+    if (SLIDER_IsStopped())  key->flags |= RENDER_F_SLIDER_STOPPED;
+}
+
+/* Grey-level seconds modes go out through the BCM engine, which has SPI1 to
+   itself while such a mode is selected. 4 bits: 271 Hz refresh at SPI1 /32. */
+#define GREY_BCM_BITS  4U
 
-    // custMode can be used for additional functionality; currently not used.
-    switch (custMode) {
-    case 0: /* ... */ break;
-    case 1: /* ... */ break;
-    case 2: /* ... */ break;
-    case 3: /* ... */ break;
-    case 4: /* ... */ break;
+/* Shows 'frame' with the ring LEDs at their grey levels: the hour rings at
+   full level where lit, the seconds ring from RING_SecondsLevels(). A new
+   sequence is only rendered when the frame changed. Returns false if the
+   engine cannot run; the caller then shows the frame as on/off LEDs. */
+static bool ShowGrey(const DisplayFrame_t* frame)
+{
+    static DisplayFrame_t s_shown;
+    static uint64_t s_shownBlank;
+    static bool s_dirty = true;
+
+    if (!BCM_IsRunning()) {
+        BCM_Stop();                 // Leftovers of a DMA error, if any
+        if (!BCM_Start(GREY_BCM_BITS, frame)) {
+            return false;
+        }
+        s_dirty = true;
+    }
+    /* The seconds levels do not come from the frame: the menu blanking too */
+    uint64_t blank = ReadFrameBits(&s_menuBlank, FRAME_OFS_SECONDS_RING, FRAME_LEN_SECONDS_RING);
+    if (!s_dirty && blank == s_shownBlank && memcmp(frame, &s_shown, sizeof(*frame)) == 0) {
+        return true;
+    }
+
+    const uint8_t full = (uint8_t)((1U << GREY_BCM_BITS) - 1U);
+    uint8_t level[FRAME_LEN_SECONDS_RING];
+    RING_SecondsLevels(MENU_GetMode(MENU_ITEM_SECD), sTime.Seconds, sTime.Minutes, full, level);
+    for (uint8_t s = 0; s < FRAME_LEN_SECONDS_RING; s++) {
+        BCM_SetLevel(BCM_LED_SECOND(s), ((blank >> s) & 1U) ? 0U : level[s]);
+    }
+    /* Outer and inner hour ring follow each other on the chain */
+    uint32_t hours = (uint32_t)ReadFrameBits(frame, FRAME_OFS_HOURS_OUTER,
+                                             FRAME_LEN_HOURS_OUTER + FRAME_LEN_HOURS_INNER);
+    for (uint8_t h = 0; h < FRAME_LEN_HOURS_OUTER + FRAME_LEN_HOURS_INNER; h++) {
+        BCM_SetLevel(BCM_LED_OUTER(h), ((hours >> h) & 1U) ? full : 0U);
     }
 
-    // If menu is not active, update sensor data display
+    /* Refused while the last commit is still being switched in: next pass */
+    s_dirty = !BCM_Commit(frame);
+    if (!s_dirty) {
+        s_shown = *frame;
+        s_shownBlank = blank;
+    }
+    return true;
+}
+
+// Display function called in the main loop to update hardware based on menu settings
+void Display(void){
+    static RenderKey_t s_key;
+    static bool s_keyValid = false;
+
+    RenderKey_t key;
     SHT30_Data_t data;  // Sensor data variable
-    if (!MENU_IsActive()) {
-        if (SHT30_GetLatestData(&data)) {
+    MakeRenderKey(&key, &data);
+    s_renderStats.frames++;
+
+    if (s_keyValid && memcmp(&key, &s_key, sizeof(key)) == 0) {
+        s_renderStats.hits++;
+    } else {
+        s_key = key;
+        s_keyValid = true;
+        s_renderStats.misses++;
+
+        RenderHours(MENU_GetMode(MENU_ITEM_HOUR), sTime.Hours);
+        RenderSeconds(MENU_GetMode(MENU_ITEM_SECD), sTime.Seconds, sTime.Minutes);
+        RenderDots(MENU_GetMode(MENU_ITEM_COLN), colon != 0U);
+        RenderTop(MENU_GetMode(MENU_ITEM_TOP), rtcRaw.tr);
+
+        // custMode can be used for additional functionality; currently not used.
+        switch (MENU_GetMode(MENU_ITEM_CUST)) {
+        case 0: /* ... */ break;
+        case 1: /* ... */ break;
+        case 2: /* ... */ break;
+        case 3: /* ... */ break;
+        case 4: /* ... */ break;
+        }
+
+        // If menu is not active, update sensor data display
+        if (!MENU_IsActive() && (key.flags & RENDER_F_SENSOR_VALID)) {
             disp_mode ? SLIDER_DisplayTemperature(data.temperature)
                       : SLIDER_DisplayHumidity(data.humidity);
         }
     }
-    UpdateAllDisplays(&clockReg);
+
+    RenderMenuOverlay(MENU_IsActive(), s_currentItem);
+
+    /* The slider scrolls on its own (10 ms task), so the layers are
+       committed every pass; with no layer changed this is a frame copy */
+    DisplayFrame_t frame;
+    COMP_Commit(&frame);
+    if (RING_SecondsHasLevels(MENU_GetMode(MENU_ITEM_SECD)) && ShowGrey(&frame)) {
+        return;
+    }
+    BCM_Stop();
+    UpdateAllDisplays(&frame);
+}
+
+void Display_GetRenderStats(DisplayRenderStats_t* stats)
+{
+    *stats = s_renderStats;
+    stats->layerRenders = s_layerRenders;
+}
+
+/* Pre-renders the frame for the coming second and stages it; the RTC wakeup
+   interrupt latches it on the edge. Called every main loop pass, acts in the
+   last STAGE_LEAD_MS of the second. Until the edge, normal frames are held,
+   so the lead is kept just long enough for a few loop passes to get a try. */
+#define STAGE_LEAD_MS  30U
+
+void Display_StageNextSecond(void)
+{
+    static uint32_t s_stagedTr = 0xFFFFFFFFU;   // Second whose successor is staged
+
+    if (BCM_IsRunning()) {
+        return;     // SPI1 belongs to the BCM engine, nothing can be staged
+    }
+
+    uint32_t edge = DISPLAY_EdgeCount();       // Before the RTC read, see DISPLAY_StageFrame()
+    RTC_Raw_t next;
+    RTC_ReadRaw(&next);
+    if (next.tr == s_stagedTr || RTC_SubsecondMillis(&next) < 1000U - STAGE_LEAD_MS) {
+        return;
+    }
+    uint32_t tr = next.tr;
+
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+    RTC_RawNextSecond(&next);
+    RTC_RawToTime(&next, &time, &date);
+
+    /* The layers that follow the time, drawn ahead on copies; the live
+       layers and their renderers are not touched */
+    DisplayFrame_t seconds, hours, top;
+    COMP_ReadLayer(COMP_LAYER_SECONDS, &seconds);
+    COMP_ReadLayer(COMP_LAYER_HOURS, &hours);
+    COMP_ReadLayer(COMP_LAYER_TOP, &top);
+    RING_DrawSeconds(&seconds, MENU_GetMode(MENU_ITEM_SECD), time.Seconds, time.Minutes);
+    RING_DrawHours(&hours, MENU_GetMode(MENU_ITEM_HOUR), time.Hours);
+    DrawTop(&top, MENU_GetMode(MENU_ITEM_TOP), next.tr);
+
+    const DisplayFrame_t* replace[COMP_LAYER_COUNT] = {
+        [COMP_LAYER_SECONDS] = &seconds,
+        [COMP_LAYER_HOURS]   = &hours,
+        [COMP_LAYER_TOP]     = &top,
+    };
+    DisplayFrame_t frame;
+    COMP_Preview(&frame, replace);
+    if (DISPLAY_StageFrame(&frame, edge)) {
+        s_stagedTr = tr;
+    }
 }
@@ -0,0 +1,289 @@
+/*
+ * nmea.c
+ *
+ *  NMEA 0183 streaming tokenizer, see nmea.h
+ */
+
+#include "nmea.h"
+#include <stddef.h>
+
+enum
+{
+    ST_WAIT = 0,        // Looking for '$'
+    ST_BODY,            // Between '$' and '*'
+    ST_CK_HI,           // First checksum digit
+    ST_CK_LO            // Second checksum digit
+};
+
+// No collisions for RMC, GGA, ZDA, GSA, GSV, GLL, VTG, TXT: one probe each
+static uint8_t Hash(uint16_t id)
+{
+    return (uint8_t)((id ^ (id >> 5) ^ (id >> 6)) & (NMEA_HASH_SIZE - 1U));
+}
+
+// Entry of a registered ID or NMEA_UNREGISTERED
+static uint8_t Lookup(const NMEA_Parser_t* p, uint16_t id)
+{
+    uint8_t slot = Hash(id);
+    for (uint8_t n = 0; n < NMEA_HASH_SIZE; n++) {
+        uint8_t e = p->index[slot];
+        if (e == 0U) break;
+        if (p->entry[e - 1U].id == id) return (uint8_t)(e - 1U);
+        slot = (uint8_t)((slot + 1U) & (NMEA_HASH_SIZE - 1U));
+    }
+    return NMEA_UNREGISTERED;
+}
+
+void NMEA_Init(NMEA_Parser_t* parser)
+{
+    *parser = (NMEA_Parser_t){ 0 };
+    parser->sentence.entry = NMEA_UNREGISTERED;
+}
+
+bool NMEA_Register(NMEA_Parser_t* parser, uint16_t id, NMEA_Handler_t handler)
+{
+    if (id == NMEA_ID_NONE) {
+        return false;
+    }
+    uint8_t e = Lookup(parser, id);
+    if (e != NMEA_UNREGISTERED) {
+        parser->entry[e].handler = handler;
+        return true;
+    }
+    if (parser->entryCount >= NMEA_MAX_SENTENCES) {
+        return false;
+    }
+    e = parser->entryCount++;
+    parser->entry[e] = (NMEA_Entry_t){ .id = id, .handler = handler };
+    uint8_t slot = Hash(id);
+    while (parser->index[slot] != 0U) {
+        slot = (uint8_t)((slot + 1U) & (NMEA_HASH_SIZE - 1U));
+    }
+    parser->index[slot] = (uint8_t)(e + 1U);
+    return true;
+}
+
+bool NMEA_GetStats(const NMEA_Parser_t* parser, uint16_t id, NMEA_TypeStats_t* stats)
+{
+    uint8_t e = Lookup(parser, id);
+    if (e == NMEA_UNREGISTERED) {
+        return false;
+    }
+    *stats = parser->entry[e].stats;
+    return true;
+}
+
+void NMEA_Reset(NMEA_Parser_t* parser)
+{
+    parser->state = ST_WAIT;
+}
+
+static int8_t HexValue(uint8_t c)
+{
+    if (c >= '0' && c <= '9') return (int8_t)(c - '0');
+    if (c >= 'A' && c <= 'F') return (int8_t)(c - 'A' + 10);
+    if (c >= 'a' && c <= 'f') return (int8_t)(c - 'a' + 10);
+    return -1;
+}
+
+static bool IsUpper(char c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+// Address "ttSSS": any two-letter talker, three-letter sentence ID
+static void Classify(NMEA_Parser_t* p)
+{
+    NMEA_Sentence_t* s = &p->sentence;
+    char c[5];
+    for (uint8_t i = 0; i < 5U; i++) c[i] = NMEA_FieldChar(s, 0, i);
+    if (NMEA_FieldLen(s, 0) != 5U || c[0] == 'P' ||
+        !IsUpper(c[0]) || !IsUpper(c[1]) || !IsUpper(c[2]) || !IsUpper(c[3]) || !IsUpper(c[4])) {
+        return;                         // Proprietary ("$PUBX") or malformed
+    }
+    s->talker = NMEA_TALKER(c[0], c[1]);
+    s->id = NMEA_ID(c[2], c[3], c[4]);
+    s->entry = Lookup(p, s->id);
+}
+
+static NMEA_TypeStats_t* Stats(NMEA_Parser_t* p)
+{
+    uint8_t e = p->sentence.entry;
+    return (e == NMEA_UNREGISTERED) ? &p->unregistered : &p->entry[e].stats;
+}
+
+// Closes the field that ends at ring offset 'pos'
+static bool EndField(NMEA_Parser_t* p, uint16_t pos)
+{
+    NMEA_Sentence_t* s = &p->sentence;
+    NMEA_Field_t* f = &s->field[s->fieldCount];
+    uint16_t len = (pos >= f->start) ? (uint16_t)(pos - f->start) : (uint16_t)(pos + s->ringSize - f->start);
+    f->len = (uint8_t)len;
+    s->fieldCount++;
+    if (s->fieldCount == 1U) {
+        Classify(p);                    // Address known: counters go to its entry from here on
+    }
+    return s->fieldCount < NMEA_MAX_FIELDS;
+}
+
+static void StartField(NMEA_Parser_t* p, uint16_t pos)
+{
+    p->sentence.field[p->sentence.fieldCount].start = pos;
+}
+
+uint16_t NMEA_Feed(NMEA_Parser_t* p, const uint8_t* ring, uint16_t ringSize,
+                   uint16_t from, uint16_t to)
+{
+    NMEA_Sentence_t* s = &p->sentence;
+    s->ring = ring;
+    s->ringSize = ringSize;
+
+    for (uint16_t pos = from; pos != to; ) {
+        uint8_t c = ring[pos];
+        uint16_t next = (uint16_t)(pos + 1U);
+        if (next >= ringSize) next = 0;
+
+        if (c == '$') {
+            if (p->state != ST_WAIT) p->interrupted++;
+            p->state = ST_BODY;
+            p->length = 1;
+            p->checksum = 0;
+            s->fieldCount = 0;
+            s->talker = 0;
+            s->id = NMEA_ID_NONE;
+            s->entry = NMEA_UNREGISTERED;
+            StartField(p, next);
+            pos = next;
+            continue;
+        }
+        if (p->state == ST_WAIT) {
+            pos = next;
+            continue;
+        }
+        if (++p->length > NMEA_MAX_LEN) {
+            Stats(p)->overlong++;
+            p->state = ST_WAIT;
+            pos = next;
+            continue;
+        }
+
+        switch (p->state) {
+        case ST_BODY:
+            if (c == '*') {
+                EndField(p, pos);
+                p->state = ST_CK_HI;
+            } else if (c == '\r' || c == '\n') {
+                Stats(p)->badChecksum++;    // No checksum: never trusted
+                p->state = ST_WAIT;
+            } else {
+                p->checksum ^= c;
+                if (c == ',') {
+                    if (!EndField(p, pos)) {
+                        Stats(p)->overlong++;
+                        p->state = ST_WAIT;
+                        break;
+                    }
+                    StartField(p, next);
+                }
+            }
+            break;
+
+        case ST_CK_HI: {
+            int8_t v = HexValue(c);
+            if (v < 0) {
+                Stats(p)->badChecksum++;
+                p->state = ST_WAIT;
+            } else {
+                p->received = (uint8_t)(v << 4);
+                p->state = ST_CK_LO;
+            }
+            break;
+        }
+
+        case ST_CK_LO: {
+            int8_t v = HexValue(c);
+            p->state = ST_WAIT;
+            if (v < 0 || (uint8_t)(p->received | (uint8_t)v) != p->checksum) {
+                Stats(p)->badChecksum++;
+            } else {
+                Stats(p)->accepted++;
+                s->end = next;
+                if (s->entry != NMEA_UNREGISTERED && p->entry[s->entry].handler != NULL) {
+                    p->entry[s->entry].handler(s);
+                }
+            }
+            break;
+        }
+        }
+        pos = next;
+    }
+    return to;
+}
+
+uint8_t NMEA_FieldLen(const NMEA_Sentence_t* s, uint8_t index)
+{
+    return (index < s->fieldCount) ? s->field[index].len : 0U;
+}
+
+char NMEA_FieldChar(const NMEA_Sentence_t* s, uint8_t index, uint8_t pos)
+{
+    if (index >= s->fieldCount || pos >= s->field[index].len) {
+        return '\0';
+    }
+    uint16_t at = (uint16_t)(s->field[index].start + pos);
+    if (at >= s->ringSize) at = (uint16_t)(at - s->ringSize);
+    return (char)s->ring[at];
+}
+
+bool NMEA_FieldDigits(const NMEA_Sentence_t* s, uint8_t index, uint8_t pos, uint8_t digits, uint32_t* value)
+{
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < digits; i++) {
+        char c = NMEA_FieldChar(s, index, (uint8_t)(pos + i));
+        if (c < '0' || c > '9') return false;
+        v = v * 10U + (uint32_t)(c - '0');
+    }
+    *value = v;
+    return true;
+}
+
+bool NMEA_FieldUInt(const NMEA_Sentence_t* s, uint8_t index, uint32_t* value)
+{
+    uint8_t len = NMEA_FieldLen(s, index);
+    uint32_t v = 0;
+    uint8_t i = 0;
+    for (; i < len; i++) {
+        char c = NMEA_FieldChar(s, index, i);
+        if (c < '0' || c > '9') break;
+        v = v * 10U + (uint32_t)(c - '0');
+    }
+    if (i == 0U) return false;
+    *value = v;
+    return true;
+}
+
+bool NMEA_FieldDecimal(const NMEA_Sentence_t* s, uint8_t index, uint8_t decimals, uint32_t* value)
+{
+    uint8_t len = NMEA_FieldLen(s, index);
+    uint32_t v = 0;
+    uint8_t i = 0, frac = 0;
+    bool point = false, any = false;
+    for (; i < len; i++) {
+        char c = NMEA_FieldChar(s, index, i);
+        if (c == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (c < '0' || c > '9') break;
+        if (point) {
+            if (frac >= decimals) continue;
+            frac++;
+        }
+        v = v * 10U + (uint32_t)(c - '0');
+        any = true;
+    }
+    if (!any) return false;
+    for (; frac < decimals; frac++) v *= 10U;
+    *value = v;
+    return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * pps.c
+ *
+ *  GPS 1PPS edge tracking, see pps.h
+ */
+
+#include "pps.h"
+
+#define MEAN_SHIFT  3U               // Mean period IIR, 1/8 per edge
+
+/* Writer and readers share the one core, so ordering by the compiler is
+   enough (compositor.c has __DMB, which this file cannot use on the host) */
+#define BARRIER()   __asm volatile ("" ::: "memory")
+
+/* Written by the capture ISR; the main context reads them between two
+   equal, even s_seq values (as in compositor.c) */
+static volatile uint32_t s_seq = 0;
+static volatile uint32_t s_edge = 0;         // Latest edge
+static volatile uint32_t s_prevEdge = 0;     // The one before
+static volatile bool     s_locked = false;
+static uint8_t  s_good = 0;                  // Good periods in a row
+static bool     s_haveEdge = false;
+static uint32_t s_meanQ = PPS_PERIOD_US << MEAN_SHIFT;
+static PPS_Stats_t s_stats;
+
+void PPS_Init(void)
+{
+    s_seq = 0;
+    s_locked = false;
+    s_good = 0;
+    s_haveEdge = false;
+    s_meanQ = PPS_PERIOD_US << MEAN_SHIFT;
+    s_stats = (PPS_Stats_t){ .periodUs = PPS_PERIOD_US, .nmeaDelayMinUs = UINT32_MAX };
+}
+
+void PPS_Capture(uint32_t edgeUs)
+{
+    s_seq++;
+    BARRIER();
+    s_stats.edges++;
+    if (s_haveEdge) {
+        uint32_t period = edgeUs - s_edge;
+        int32_t error = (int32_t)(period - PPS_PERIOD_US);
+        if (error > (int32_t)PPS_TOLERANCE_US || error < -(int32_t)PPS_TOLERANCE_US) {
+            s_stats.glitches++;
+            s_good = 0;
+            s_locked = false;
+        } else {
+            int32_t jitter = (int32_t)(period - (s_meanQ >> MEAN_SHIFT));
+            s_meanQ = (uint32_t)((int32_t)s_meanQ + (int32_t)(period - (s_meanQ >> MEAN_SHIFT)));
+            s_stats.periodUs = s_meanQ >> MEAN_SHIFT;
+            s_stats.jitterLastUs = jitter;
+            if (s_locked) {
+                uint32_t a = (uint32_t)((jitter < 0) ? -jitter : jitter);
+                if (a > s_stats.jitterMaxUs) s_stats.jitterMaxUs = a;
+            } else if (++s_good >= PPS_LOCK_EDGES) {
+                s_locked = true;
+                s_stats.locks++;
+            }
+        }
+    }
+    s_prevEdge = s_edge;
+    s_edge = edgeUs;
+    s_haveEdge = true;
+    BARRIER();
+    s_seq++;
+}
+
+// Consistent copy of the ISR state
+static void Snapshot(uint32_t* edge, uint32_t* prev, bool* locked)
+{
+    uint32_t seq;
+    do {
+        seq = s_seq;
+        BARRIER();
+        *edge = s_edge;
+        *prev = s_prevEdge;
+        *locked = s_locked;
+        BARRIER();
+    } while ((seq & 1U) != 0U || seq != s_seq);
+}
+
+bool PPS_Associate(uint32_t endUs, uint32_t* edgeUs)
+{
+    uint32_t edge, prev;
+    bool locked;
+    Snapshot(&edge, &prev, &locked);
+
+    /* An edge may have come between the end of the sentence and now */
+    uint32_t since = endUs - edge;
+    if (since > PPS_TIMEOUT_US) {
+        edge = prev;
+        since = endUs - prev;
+    }
+    if (!locked || since > PPS_NMEA_MAX_US) {
+        s_stats.nmeaOnly++;
+        return false;
+    }
+    s_stats.associated++;
+    s_stats.nmeaDelayLastUs = since;
+    if (since < s_stats.nmeaDelayMinUs) s_stats.nmeaDelayMinUs = since;
+    if (since > s_stats.nmeaDelayMaxUs) s_stats.nmeaDelayMaxUs = since;
+    *edgeUs = edge;
+    return true;
+}
+
+void PPS_GetStats(PPS_Stats_t* stats)
+{
+    uint32_t seq;
+    do {
+        seq = s_seq;
+        BARRIER();
+        *stats = s_stats;
+        BARRIER();
+    } while ((seq & 1U) != 0U || seq != s_seq);
+}
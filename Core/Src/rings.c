@@ -0,0 +1,170 @@
+/*
+ * rings.c
+ *
+ *  Ring pattern banks and mode tables, see rings.h
+ */
+
+#include "rings.h"
+
+#define RING_SEC_ALL    ((1ULL << FRAME_LEN_SECONDS_RING) - 1U)
+#define RING_HOUR_ALL   ((uint16_t)((1U << FRAME_LEN_HOURS_OUTER) - 1U))
+
+/* ---- Bank generators: F(n) for n = 0..59 / 0..11, expanded by the compiler ---- */
+#define BANK_4(F, n)    F(n), F((n) + 1), F((n) + 2), F((n) + 3)
+#define BANK_12(F)      BANK_4(F, 0), BANK_4(F, 4), BANK_4(F, 8)
+#define BANK_20(F, n)   BANK_4(F, n), BANK_4(F, (n) + 4), BANK_4(F, (n) + 8), \
+                        BANK_4(F, (n) + 12), BANK_4(F, (n) + 16)
+#define BANK_60(F)      BANK_20(F, 0), BANK_20(F, 20), BANK_20(F, 40)
+
+#define SEC_BIT(n)      (1ULL << (((n) + 60) % 60))
+#define HOUR_BIT(n)     (uint16_t)(1U << (((n) + 12) % 12))
+
+/* Seconds banks */
+#define COMET(s)        (SEC_BIT(s) | SEC_BIT((s) - 1) | SEC_BIT((s) - 2) | SEC_BIT((s) - 3))
+#define SPLIT(s)        (SEC_BIT(s) | SEC_BIT(60 - (s)))
+
+static const uint64_t s_comet[60] = { BANK_60(COMET) };
+static const uint64_t s_split[60] = { BANK_60(SPLIT) };
+
+/* Hour banks */
+#define TRAIL(h)        (uint16_t)(HOUR_BIT(h) | HOUR_BIT((h) - 1))
+
+static const uint16_t s_trail[12] = { BANK_12(TRAIL) };
+
+/* Closed-form masks */
+static uint64_t SecSingle(uint8_t s, uint8_t m)     { (void)m; return 1ULL << s; }
+static uint64_t SecAccumulate(uint8_t s, uint8_t m) { (void)m; return s == 0U ? 0ULL : ((2ULL << s) - 1U) & ~1ULL; }
+static uint64_t SecFill(uint8_t s, uint8_t m)       { (void)m; return (2ULL << s) - 1U; }
+static uint64_t SecEvenOdd(uint8_t s, uint8_t m)
+{
+    uint64_t fill = (2ULL << s) - 1U;
+    return (m & 1U) ? (RING_SEC_ALL & ~fill) : fill;
+}
+static uint16_t HourHand(uint8_t h)     { return (uint16_t)(1U << h); }
+static uint16_t HourFill(uint8_t h)     { return (uint16_t)((2U << h) - 1U); }
+
+/* ---- Patterns: bank or expression (or neither), plus constant marks ---- */
+typedef struct
+{
+  const uint64_t* bank;
+  uint64_t (*expr)(uint8_t second, uint8_t minute);
+  uint64_t marks;
+  uint8_t  fade;      /* Tail LEDs behind the second, each at half the level of the one before */
+} SecPattern_t;
+
+typedef struct
+{
+  const uint16_t* bank;
+  uint16_t (*expr)(uint8_t hour12);
+  uint16_t marks;
+} HourPattern_t;
+
+#define SEC_QUARTER_MARKS  (SEC_BIT(0) | SEC_BIT(15) | SEC_BIT(30) | SEC_BIT(45))
+#define SEC_FIVE_MARKS     (SEC_BIT(0) | SEC_BIT(5) | SEC_BIT(10) | SEC_BIT(15) | SEC_BIT(20) | SEC_BIT(25) | \
+                            SEC_BIT(30) | SEC_BIT(35) | SEC_BIT(40) | SEC_BIT(45) | SEC_BIT(50) | SEC_BIT(55))
+#define HOUR_QUARTER_MARKS (uint16_t)(HOUR_BIT(0) | HOUR_BIT(3) | HOUR_BIT(6) | HOUR_BIT(9))
+
+static const SecPattern_t s_secModes[RING_SECONDS_MODE_COUNT] = {
+    [RING_SEC_SINGLE]     = { .expr = SecSingle },
+    [RING_SEC_ACCUMULATE] = { .expr = SecAccumulate },
+    [RING_SEC_FILL]       = { .expr = SecFill },
+    [RING_SEC_EVEN_ODD]   = { .expr = SecEvenOdd },
+    [RING_SEC_COMET]      = { .bank = s_comet },
+    [RING_SEC_SPLIT]      = { .bank = s_split },
+    [RING_SEC_QUARTERS]   = { .expr = SecSingle, .marks = SEC_QUARTER_MARKS },
+    [RING_SEC_FIVES]      = { .expr = SecSingle, .marks = SEC_FIVE_MARKS },
+    [RING_SEC_COMET_FADE] = { .bank = s_comet, .fade = 3 },
+};
+
+static const HourPattern_t s_hourOff      = { 0 };
+static const HourPattern_t s_hourFull     = { .marks = RING_HOUR_ALL };
+static const HourPattern_t s_hourQuarters = { .marks = HOUR_QUARTER_MARKS };
+static const HourPattern_t s_hourHand     = { .expr = HourHand };
+static const HourPattern_t s_hourFill     = { .expr = HourFill };
+static const HourPattern_t s_hourTrail    = { .bank = s_trail };
+
+static const struct
+{
+  const HourPattern_t* outer;
+  const HourPattern_t* inner;
+} s_hourModes[RING_HOURS_MODE_COUNT] = {
+    [RING_HOUR_BOTH_FULL]      = { &s_hourFull,     &s_hourFull },
+    [RING_HOUR_INNER_FULL]     = { &s_hourOff,      &s_hourFull },
+    [RING_HOUR_OUTER_FULL]     = { &s_hourFull,     &s_hourOff },
+    [RING_HOUR_OFF]            = { &s_hourOff,      &s_hourOff },
+    [RING_HOUR_QUARTERS_HAND]  = { &s_hourQuarters, &s_hourHand },
+    [RING_HOUR_HAND_FILL]      = { &s_hourHand,     &s_hourFill },
+    [RING_HOUR_HAND_TRAIL]     = { &s_hourTrail,    &s_hourTrail },
+};
+
+uint64_t RING_SecondsMask(uint8_t mode, uint8_t second, uint8_t minute)
+{
+    if (mode >= RING_SECONDS_MODE_COUNT) return 0ULL;
+    if (second >= 60U) second = 59U;
+
+    const SecPattern_t* p = &s_secModes[mode];
+    uint64_t mask = p->marks;
+    if (p->bank != NULL) {
+        mask |= p->bank[second];
+    } else if (p->expr != NULL) {
+        mask |= p->expr(second, minute);
+    }
+    return mask;
+}
+
+bool RING_SecondsHasLevels(uint8_t mode)
+{
+    return (mode < RING_SECONDS_MODE_COUNT) && (s_secModes[mode].fade != 0U);
+}
+
+void RING_SecondsLevels(uint8_t mode, uint8_t second, uint8_t minute, uint8_t full,
+                        uint8_t level[FRAME_LEN_SECONDS_RING])
+{
+    uint64_t mask = RING_SecondsMask(mode, second, minute);
+    for (uint8_t n = 0; n < FRAME_LEN_SECONDS_RING; n++) {
+        level[n] = ((mask >> n) & 1U) ? full : 0U;
+    }
+    if (!RING_SecondsHasLevels(mode)) return;
+    if (second >= 60U) second = 59U;
+
+    for (uint8_t i = 1; i <= s_secModes[mode].fade; i++) {
+        level[(second + 60U - i) % 60U] = (uint8_t)(full >> i);
+    }
+}
+
+static uint16_t HourMask(const HourPattern_t* p, uint8_t h12)
+{
+    uint16_t mask = p->marks;
+    if (p->bank != NULL) {
+        mask |= p->bank[h12];
+    } else if (p->expr != NULL) {
+        mask |= p->expr(h12);
+    }
+    return mask;
+}
+
+void RING_HoursMasks(uint8_t mode, uint8_t hour, uint16_t* outer, uint16_t* inner)
+{
+    if (mode >= RING_HOURS_MODE_COUNT) {
+        *outer = 0;
+        *inner = 0;
+        return;
+    }
+    uint8_t h12 = hour % 12U;
+    *outer = HourMask(s_hourModes[mode].outer, h12);
+    *inner = HourMask(s_hourModes[mode].inner, h12);
+}
+
+void RING_DrawSeconds(DisplayFrame_t* frame, uint8_t mode, uint8_t second, uint8_t minute)
+{
+    WriteFrameBits(frame, FRAME_OFS_SECONDS_RING, FRAME_LEN_SECONDS_RING,
+                   RING_SecondsMask(mode, second, minute));
+}
+
+void RING_DrawHours(DisplayFrame_t* frame, uint8_t mode, uint8_t hour)
+{
+    uint16_t outer, inner;
+    RING_HoursMasks(mode, hour, &outer, &inner);
+    WriteFrameBits(frame, FRAME_OFS_HOURS_OUTER, FRAME_LEN_HOURS_OUTER, outer);
+    WriteFrameBits(frame, FRAME_OFS_HOURS_INNER, FRAME_LEN_HOURS_INNER, inner);
+}
@@ -45,8 +45,8 @@ void MX_RTC_Init(void)
   */
   hrtc.Instance = RTC;
   hrtc.Init.HourFormat = RTC_HOURFORMAT_24;
-  hrtc.Init.AsynchPrediv = 127;
-  hrtc.Init.SynchPrediv = 255;
+  hrtc.Init.AsynchPrediv = 3;
+  hrtc.Init.SynchPrediv = 8191;
   hrtc.Init.OutPut = RTC_OUTPUT_DISABLE;
   hrtc.Init.OutPutPolarity = RTC_OUTPUT_POLARITY_HIGH;
   hrtc.Init.OutPutType = RTC_OUTPUT_TYPE_OPENDRAIN;
@@ -79,8 +79,21 @@ void MX_RTC_Init(void)
   {
     Error_Handler();
   }
-  /* USER CODE BEGIN RTC_Init 2 */
 
+  /** Enable the WakeUp
+  */
+  if (HAL_RTCEx_SetWakeUpTimer_IT(&hrtc, 0, RTC_WAKEUPCLOCK_CK_SPRE_16BITS) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN RTC_Init 2 */
+  /* Wakeup counts ck_spre, the clock that advances the calendar: WUT = 0
+     raises the interrupt on every second edge.
+     PREDIV_A 3 / PREDIV_S 8191: SSR and SHIFTR steps of 122 us for the GPS
+     discipline (timesync.c); PREDIV_A >= 3 keeps CALP usable */
+#if RTC_SECOND_PROBE_OUTPUT
+  HAL_RTCEx_SetCalibrationOutPut(&hrtc, RTC_CALIBOUTPUT_1HZ);
+#endif
   /* USER CODE END RTC_Init 2 */
 
 }
@@ -106,6 +119,10 @@ void HAL_RTC_MspInit(RTC_HandleTypeDef* rtcHandle)
 
     /* RTC clock enable */
     __HAL_RCC_RTC_ENABLE();
+
+    /* RTC interrupt Init */
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
   /* USER CODE BEGIN RTC_MspInit 1 */
 
   /* USER CODE END RTC_MspInit 1 */
@@ -122,6 +139,9 @@ void HAL_RTC_MspDeInit(RTC_HandleTypeDef* rtcHandle)
   /* USER CODE END RTC_MspDeInit 0 */
     /* Peripheral clock disable */
     __HAL_RCC_RTC_DISABLE();
+
+    /* RTC interrupt Deinit */
+    HAL_NVIC_DisableIRQ(RTC_WKUP_IRQn);
   /* USER CODE BEGIN RTC_MspDeInit 1 */
 
   /* USER CODE END RTC_MspDeInit 1 */
@@ -130,4 +150,80 @@ void HAL_RTC_MspDeInit(RTC_HandleTypeDef* rtcHandle)
 
 /* USER CODE BEGIN 1 */
 
+/* Calendar snapshot straight from the registers, without HAL conversions.
+   With shadow registers on (BYPSHAD = 0) reading SSR locks TR and DR,
+   and reading TR locks DR, until DR is read. SSR -> TR -> DR therefore
+   gives one consistent instant. */
+void RTC_ReadRaw(RTC_Raw_t* raw)
+{
+  raw->ssr = RTC->SSR & RTC_SSR_SS;
+  raw->tr  = RTC->TR & RTC_TR_RESERVED_MASK;
+  raw->dr  = RTC->DR & RTC_DR_RESERVED_MASK;
+}
+
+/* Binary fields for code that counts (rings, GPS); the 7-seg time uses the
+   BCD snapshot directly */
+void RTC_RawToTime(const RTC_Raw_t* raw, RTC_TimeTypeDef* time, RTC_DateTypeDef* date)
+{
+  time->Hours          = RTC_Bcd2ToByte((uint8_t)((raw->tr & (RTC_TR_HT | RTC_TR_HU)) >> RTC_TR_HU_Pos));
+  time->Minutes        = RTC_Bcd2ToByte((uint8_t)((raw->tr & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos));
+  time->Seconds        = RTC_Bcd2ToByte((uint8_t)((raw->tr & (RTC_TR_ST | RTC_TR_SU)) >> RTC_TR_SU_Pos));
+  time->TimeFormat     = (uint8_t)((raw->tr & RTC_TR_PM) >> RTC_TR_PM_Pos);
+  time->SubSeconds     = raw->ssr;
+  time->SecondFraction = hrtc.Init.SynchPrediv;
+
+  date->Year    = RTC_Bcd2ToByte((uint8_t)((raw->dr & (RTC_DR_YT | RTC_DR_YU)) >> RTC_DR_YU_Pos));
+  date->Month   = RTC_Bcd2ToByte((uint8_t)((raw->dr & (RTC_DR_MT | RTC_DR_MU)) >> RTC_DR_MU_Pos));
+  date->Date    = RTC_Bcd2ToByte((uint8_t)((raw->dr & (RTC_DR_DT | RTC_DR_DU)) >> RTC_DR_DU_Pos));
+  date->WeekDay = (uint8_t)((raw->dr & RTC_DR_WDU) >> RTC_DR_WDU_Pos);
+}
+
+/* Milliseconds into the current second (SSR counts down from PREDIV_S) */
+uint16_t RTC_SubsecondMillis(const RTC_Raw_t* raw)
+{
+  uint32_t prediv = hrtc.Init.SynchPrediv;
+  uint32_t elapsed = (raw->ssr <= prediv) ? (prediv - raw->ssr) : 0U;  // SSR > PREDIV_S only right after a shift
+  return (uint16_t)((elapsed * 1000U) / (prediv + 1U));
+}
+
+/* Advances a snapshot by one second, in BCD (24 h, wraps 23:59:59 -> 00:00:00).
+   The date is left alone: the frame rendered for the next edge never shows it.
+   SSR is set to the start of the new second. */
+void RTC_RawNextSecond(RTC_Raw_t* raw)
+{
+  uint32_t tr = raw->tr;
+  uint32_t su  = (tr & RTC_TR_SU)  >> RTC_TR_SU_Pos;
+  uint32_t st  = (tr & RTC_TR_ST)  >> RTC_TR_ST_Pos;
+  uint32_t mnu = (tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos;
+  uint32_t mnt = (tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos;
+  uint32_t hu  = (tr & RTC_TR_HU)  >> RTC_TR_HU_Pos;
+  uint32_t ht  = (tr & RTC_TR_HT)  >> RTC_TR_HT_Pos;
+
+  if (++su > 9U) {
+    su = 0U;
+    if (++st > 5U) {
+      st = 0U;
+      if (++mnu > 9U) {
+        mnu = 0U;
+        if (++mnt > 5U) {
+          mnt = 0U;
+          if (ht == 2U && hu == 3U) {
+            ht = 0U;
+            hu = 0U;
+          } else if (++hu > 9U) {
+            hu = 0U;
+            ht++;
+          }
+        }
+      }
+    }
+  }
+
+  raw->tr = (tr & RTC_TR_PM)
+          | (ht << RTC_TR_HT_Pos) | (hu << RTC_TR_HU_Pos)
+          | (mnt << RTC_TR_MNT_Pos) | (mnu << RTC_TR_MNU_Pos)
+          | (st << RTC_TR_ST_Pos) | (su << RTC_TR_SU_Pos);
+  raw->ssr = hrtc.Init.SynchPrediv;
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,168 @@
+/*
+ * sched.c
+ *
+ *  Cooperative task scheduler, see sched.h
+ */
+
+#include "sched.h"
+#include "main.h"
+
+typedef struct
+{
+  SCHED_TaskFn_t fn;
+  uint32_t period;        // ms, 0 = events only
+  uint32_t deadline;      // ms, 0 = none
+  uint32_t events;        // Subscribed event bits
+  uint32_t pending;       // Subscribed events seen, not yet handled
+  uint32_t due;           // Next periodic release (HAL tick)
+  uint32_t release;       // Release of the current job
+  bool     released;
+  SCHED_Stats_t stats;
+} Task_t;
+
+static Task_t s_tasks[SCHED_MAX_TASKS];
+static uint8_t s_count = 0;
+static volatile uint32_t s_events = 0;     // Set by interrupts, taken by Collect()
+static uint64_t s_idleCycles = 0;
+
+int8_t SCHED_AddTask(const char* name, SCHED_TaskFn_t fn, uint32_t periodMs,
+                     uint32_t deadlineMs, uint32_t events)
+{
+    if (s_count >= SCHED_MAX_TASKS || fn == NULL || (periodMs == 0U && events == 0U)) {
+        return -1;
+    }
+    Task_t* t = &s_tasks[s_count];
+    t->fn = fn;
+    t->period = periodMs;
+    t->deadline = deadlineMs;
+    t->events = events;
+    t->pending = 0;
+    t->due = HAL_GetTick() + periodMs;
+    t->released = false;
+    t->stats = (SCHED_Stats_t){ .name = name };
+    return (int8_t)s_count++;
+}
+
+void SCHED_SetEvent(uint32_t events)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    s_events |= events;
+    __set_PRIMASK(primask);
+}
+
+// Moves interrupt events to the subscribed tasks and releases the due ones
+static bool Collect(uint32_t now)
+{
+    uint32_t events = 0;
+    if (s_events != 0U) {
+        uint32_t primask = __get_PRIMASK();   // Also called with interrupts off
+        __disable_irq();
+        events = s_events;
+        s_events = 0;
+        __set_PRIMASK(primask);
+    }
+
+    bool ready = false;
+    for (uint8_t i = 0; i < s_count; i++) {
+        Task_t* t = &s_tasks[i];
+        t->pending |= events & t->events;
+        bool periodic = (t->period != 0U) && (int32_t)(now - t->due) >= 0;
+        if (!t->released && (t->pending != 0U || periodic)) {
+            t->released = true;
+            t->release = periodic ? t->due : now;
+        }
+        ready |= t->released;
+    }
+    return ready;
+}
+
+static void Dispatch(Task_t* t)
+{
+    t->pending = 0;
+
+    uint32_t start = DWT->CYCCNT;
+    t->fn();
+    uint32_t cycles = DWT->CYCCNT - start;
+    uint32_t now = HAL_GetTick();
+
+    SCHED_Stats_t* s = &t->stats;
+    s->runs++;
+    s->cyclesLast = cycles;
+    s->cyclesTotal += cycles;
+    if (cycles > s->cyclesMax) s->cyclesMax = cycles;
+    uint32_t late = now - t->release;
+    if (late > s->lateMaxMs) s->lateMaxMs = late;
+    if (t->deadline != SCHED_NO_DEADLINE && late > t->deadline) {
+        s->misses++;
+    }
+
+    if (t->period != 0U && (int32_t)(now - t->due) >= 0) {
+        /* Keep the phase; after an overrun skip the lost periods instead of
+           running the task back to back to catch up */
+        t->due += t->period;
+        if ((int32_t)(now - t->due) >= 0) {
+            t->due = now + t->period;
+        }
+    }
+    t->released = false;
+}
+
+void SCHED_Run(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    while (1) {
+        if (Collect(HAL_GetTick())) {
+            /* Highest priority ready task, then look again from the top */
+            for (uint8_t i = 0; i < s_count; i++) {
+                if (s_tasks[i].released) {
+                    Dispatch(&s_tasks[i]);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        /* With PRIMASK set a pending interrupt still ends WFI, it is only
+           taken after __enable_irq(). So an event set between Collect() and
+           here cannot be slept through. */
+        __disable_irq();
+        if (!Collect(HAL_GetTick())) {
+            uint32_t start = DWT->CYCCNT;
+            __DSB();
+            __WFI();
+            s_idleCycles += DWT->CYCCNT - start;
+        }
+        __enable_irq();
+    }
+}
+
+bool SCHED_GetStats(uint8_t id, SCHED_Stats_t* stats)
+{
+    if (id >= s_count) {
+        return false;
+    }
+    *stats = s_tasks[id].stats;
+    return true;
+}
+
+uint8_t SCHED_TaskCount(void)
+{
+    return s_count;
+}
+
+uint64_t SCHED_IdleCycles(void)
+{
+    return s_idleCycles;
+}
+
+void SCHED_ResetStats(void)
+{
+    for (uint8_t i = 0; i < s_count; i++) {
+        const char* name = s_tasks[i].stats.name;
+        s_tasks[i].stats = (SCHED_Stats_t){ .name = name };
+    }
+    s_idleCycles = 0;
+}
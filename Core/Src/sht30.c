@@ -15,14 +15,16 @@ static const uint8_t SHT30_CMD_SINGLE_SHOT[2] = {0x24, 0x00};
 // Buffer for 6 bytes of sensor data
 static uint8_t g_rxBuffer[6];
 
-// State variable for the SHT30 state machine
-static SHT30_MeasState_t g_measState = SHT30_STATE_IDLE;
+// State variable for the SHT30 state machine.
+// The handler runs in the main context and the I2C callbacks preempt it, so
+// a state is always entered before the transfer that leaves it is started.
+static volatile SHT30_MeasState_t g_measState = SHT30_STATE_IDLE;
 
 // Latest measurement data
 static SHT30_Data_t g_latestData;
 
 // Timer counter in milliseconds
-static uint16_t g_timerMs = 0;
+static volatile uint16_t g_timerMs = 0;
 
 // Internal function prototypes
 static bool SHT30_ConvertRawData(const uint8_t *raw, int32_t *pTemp, uint32_t *pRH);
@@ -42,7 +44,7 @@ void SHT30_Init(void)
     HAL_Delay(10); // Wait a moment after reset
 }
 
-// This function is called every 10 ms (from timer interrupt)
+// This function is called every 10 ms (main context, scheduler task)
 void SHT30_10msHandler(void)
 {
     switch (g_measState)
@@ -53,15 +55,14 @@ void SHT30_10msHandler(void)
         if (g_timerMs >= SHT30_PERIOD_MS)
         {
             g_timerMs = 0; // Reset timer
+            // TX callback may run before Transmit_DMA returns: set the state first
+            g_measState = SHT30_STATE_TX_IN_PROGRESS;
             // Start DMA transmission: send Single Shot command
             if (HAL_I2C_Master_Transmit_DMA(&hi2c2, (SHT30_I2C_ADDR << 1),
-                                            (uint8_t*)SHT30_CMD_SINGLE_SHOT, 2) == HAL_OK)
+                                            (uint8_t*)SHT30_CMD_SINGLE_SHOT, 2) != HAL_OK)
             {
-                g_measState = SHT30_STATE_TX_IN_PROGRESS;
-            }
-            else
-            {
-                // DMA start error; remain in IDLE (error handling can be added)
+                // DMA start error; back to IDLE (error handling can be added)
+                g_measState = SHT30_STATE_IDLE;
             }
         }
         break;
@@ -76,13 +77,10 @@ void SHT30_10msHandler(void)
         if (g_timerMs >= SHT30_MEAS_TIME_MS)
         {
             g_timerMs = 0; // Reset timer
+            g_measState = SHT30_STATE_RX_IN_PROGRESS;
             // Start DMA reception of 6 bytes of raw data
             if (HAL_I2C_Master_Receive_DMA(&hi2c2, (SHT30_I2C_ADDR << 1),
-                                           g_rxBuffer, 6) == HAL_OK)
-            {
-                g_measState = SHT30_STATE_RX_IN_PROGRESS;
-            }
-            else
+                                           g_rxBuffer, 6) != HAL_OK)
             {
                 g_measState = SHT30_STATE_IDLE;
                 g_latestData.valid = false;
@@ -95,9 +93,26 @@ void SHT30_10msHandler(void)
         break;
 
     case SHT30_STATE_DONE:
-        // Measurement complete; return to IDLE state
+    {
+        // Measurement complete: convert here, so g_latestData is only
+        // written in the context that reads it, then return to IDLE
+        int32_t temp;   // Temperature in 0.01°C
+        uint32_t rh;    // Humidity in 0.01%RH
+
+        bool ok = SHT30_ConvertRawData(g_rxBuffer, &temp, &rh);
+        if (ok)
+        {
+            g_latestData.temperature = temp;
+            g_latestData.humidity    = rh;
+            g_latestData.valid       = true;
+        }
+        else
+        {
+            g_latestData.valid = false;
+        }
         g_measState = SHT30_STATE_IDLE;
         break;
+    }
 
     default:
         g_measState = SHT30_STATE_IDLE;
@@ -136,21 +151,7 @@ void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
     {
         if (g_measState == SHT30_STATE_RX_IN_PROGRESS)
         {
-            int32_t temp;   // Temperature in 0.01°C
-            uint32_t rh;    // Humidity in 0.01%RH
-
-            bool ok = SHT30_ConvertRawData(g_rxBuffer, &temp, &rh);
-            if (ok)
-            {
-                g_latestData.temperature = temp;
-                g_latestData.humidity    = rh;
-                g_latestData.valid       = true;
-            }
-            else
-            {
-                g_latestData.valid = false;
-            }
-            g_measState = SHT30_STATE_DONE; // Transition to DONE state
+            g_measState = SHT30_STATE_DONE; // Data converted by SHT30_10msHandler()
         }
     }
 }
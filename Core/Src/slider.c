@@ -1,12 +1,12 @@
 #include "slider.h"
 #include "display.h"     // For UpdateAllDisplays, charToSegment
-#include "main.h"        // For clockReg, timer/HSPI access, etc.
+#include "main.h"        // Timer/HSPI access, etc.
+#include "compositor.h"  // Bottom display is the slider layer
+#include "decfmt.h"      // Glyphs straight from numbers, no division
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
 
-// External variable from main.c
-extern MyClockBitFields clockReg;
 volatile uint8_t disp_mode;
 
 // Enum for scroll phases
@@ -49,30 +49,26 @@ static void PrepareBuffer18(const char* text)
 {
     memset(buffer, 0, sizeof(buffer));  // Clear entire buffer
 
-    char temp[7];
-    strncpy(temp, text, 6);  // Copy up to 6 characters from text
-    temp[6] = '\0';          // Ensure null termination
-
-    // Indices 6..11: fill with converted characters from temp
+    // Indices 6..11: whole text field encoded in one pass, blanks after its end
+    uint64_t field = EncodeSegments6(text);
     for (int i = 0; i < 6; i++)
     {
-        if (temp[i] == '\0')
-        {
-            // If text ends, fill with 0 (blank)
-            buffer[6 + i] = 0;
-        }
-        else {
-            buffer[6 + i] = (uint8_t)charToSegment(temp[i]);
-        }
+        buffer[6 + i] = (uint8_t)(field >> (8 * i));
     }
     // Indices 0..5 and 12..17 remain 0 from memset
 }
 
+// Replaces the slider layer in one sequence-locked write
+static void PublishGlyphs(const uint8_t glyphs[SEG_DIGITS])
+{
+    DisplayFrame_t* layer = COMP_BeginWrite(COMP_LAYER_SLIDER);
+    Render7Seg(layer, DISPLAY_BOTTOM, glyphs);
+    COMP_EndWrite(COMP_LAYER_SLIDER);
+}
+
 // Displays exactly 6 bytes from buffer (from windowIndex to windowIndex+5) on bottomDisplay
 static void ShowWindow(void)
 {
-    uint64_t val = 0ULL;
-
     // Safe read from buffer (indices 0..17)
     uint8_t d0 = 0;
     if (windowIndex + 0 >= 0 && windowIndex + 0 < TOTAL_LEN)
@@ -93,16 +89,8 @@ static void ShowWindow(void)
     if (windowIndex + 5 >= 0 && windowIndex + 5 < TOTAL_LEN)
         d5 = buffer[windowIndex + 5];
 
-    // Compose a 48-bit value from 6 bytes; digit0 is placed in bits [47..40] and digit5 in bits [7..0]
-    val |= ((uint64_t)d5 << 40);
-    val |= ((uint64_t)d4 << 32);
-    val |= ((uint64_t)d3 << 24);
-    val |= ((uint64_t)d2 << 16);
-    val |= ((uint64_t)d1 << 8);
-    val |= ((uint64_t)d0 << 0);
-
-    clockReg.bottomDisplay = val;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    const uint8_t window[SEG_DIGITS] = {d0, d1, d2, d3, d4, d5};
+    PublishGlyphs(window);
 }
 
 // Initializes all slider variables to a resting state
@@ -277,6 +265,32 @@ bool SLIDER_IsStopped(void) {
     return (scrollPhase == SCROLL_PHASE_NONE);
 }
 
+/* Sensor readouts in 0.01 units: the lowest four digits, zero padded, on
+   digits 0..3 with the decimal point on digit[1] */
+static void FixedGlyphs(uint32_t value, uint8_t* digits)
+{
+    DECFMT_U32(value, digits, 4, DECFMT_ZERO_PAD);
+    digits[1] |= SEG_DP;
+}
+
+static void TemperatureGlyphs(int32_t temperature, uint8_t* digits)
+{
+    bool isNegative = (temperature < 0);
+    uint32_t magnitude = isNegative ? (0U - (uint32_t)temperature) : (uint32_t)temperature;
+
+    FixedGlyphs(magnitude, digits);
+    if (isNegative) {
+        digits[0] = charToSegment('-'); // Minus sign
+    }
+    if (isNegative && magnitude >= 10000U) {
+        digits[4] = SEG_BLANK;
+        digits[5] = charToSegment('*'); // Degree symbol only for 5-digit negative numbers
+    } else {
+        digits[4] = charToSegment('*');
+        digits[5] = charToSegment('C');
+    }
+}
+
 // Immediately displays a number on the slider (maximum 6 digits)
 void SLIDER_DisplayNumber(uint32_t number)
 {
@@ -288,23 +302,9 @@ void SLIDER_DisplayNumber(uint32_t number)
     if (number > 999999)
         number = 999999;
 
-    uint8_t digits[6];
-    for (int i = 0; i < 6; i++) {
-        digits[i] = charToSegment(' '); // Initialize digits as blank
-    }
-    for (int i = 5; i >= 0; i--) {
-        digits[i] = charToSegment('0' + (number % 10));
-        number /= 10;
-    }
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)digits[5] << 40);
-    displayVal |= ((uint64_t)digits[4] << 32);
-    displayVal |= ((uint64_t)digits[3] << 24);
-    displayVal |= ((uint64_t)digits[2] << 16);
-    displayVal |= ((uint64_t)digits[1] << 8);
-    displayVal |= ((uint64_t)digits[0] << 0);
-    clockReg.bottomDisplay = displayVal;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    uint8_t digits[SEG_DIGITS];
+    DECFMT_U32(number, digits, SEG_DIGITS, DECFMT_ZERO_PAD);
+    PublishGlyphs(digits);
 }
 
 // Displays a temperature value on the slider
@@ -326,44 +326,9 @@ void SLIDER_DisplayTemperature(int32_t temperature)
     else if (temperature < -99999)
         temperature = -99999;
 
-    uint8_t digits[6];
-    for (int i = 0; i < 6; i++) {
-        digits[i] = charToSegment(' '); // Initialize digits as blank
-    }
-    bool isNegative = false;
-    if (temperature < 0) {
-        isNegative = true;
-        temperature = -temperature;
-    }
-    if (isNegative && temperature >= 10000) {
-        digits[5] = charToSegment('*'); // Display degree symbol only for 5-digit negative numbers
-    } else {
-        digits[5] = charToSegment('C');
-        digits[4] = charToSegment('*');
-    }
-    int digitPos = 3;
-    for (int i = 0; i < 4; i++) {
-        if (temperature > 0 || i > 0) {
-            digits[digitPos - i] = charToSegment('0' + (temperature % 10));
-            temperature /= 10;
-        } else {
-            digits[digitPos - i] = charToSegment('0');
-            temperature /= 10;
-        }
-    }
-    if (isNegative) {
-        digits[0] = charToSegment('-'); // Display minus sign
-    }
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)digits[5] << 40);
-    displayVal |= ((uint64_t)digits[4] << 32);
-    displayVal |= ((uint64_t)digits[3] << 24);
-    displayVal |= ((uint64_t)digits[2] << 16);
-    displayVal |= ((uint64_t)digits[1] << 8);
-    displayVal |= ((uint64_t)digits[0] << 0);
-    displayVal |= ((uint64_t)0b10000000 << 8); // Set decimal point on digit[1]
-    clockReg.bottomDisplay = displayVal;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    uint8_t digits[SEG_DIGITS];
+    TemperatureGlyphs(temperature, digits);
+    PublishGlyphs(digits);
 }
 
 // Displays averaged temperature on the slider
@@ -406,44 +371,9 @@ void SLIDER_DisplayTemperature_AVG(int32_t currentTemperature)
     else if (averageTemperature < -99999)
         averageTemperature = -99999;
 
-    uint8_t digits[6];
-    for (int i = 0; i < 6; i++) {
-        digits[i] = charToSegment(' '); // Initialize with blank
-    }
-    bool isNegative = (averageTemperature < 0);
-    if (isNegative) {
-        averageTemperature = -averageTemperature;
-    }
-    if (isNegative && averageTemperature >= 10000) {
-        digits[5] = charToSegment('*');
-    } else {
-        digits[5] = charToSegment('C');
-        digits[4] = charToSegment('*');
-    }
-    int digitPos = 3;
-    int32_t tempVal = averageTemperature;
-    for (int i = 0; i < 4; i++) {
-        if (tempVal > 0 || i == 0) {
-            digits[digitPos - i] = charToSegment('0' + (tempVal % 10));
-            tempVal /= 10;
-        } else {
-            digits[digitPos - i] = charToSegment('0');
-            tempVal /= 10;
-        }
-    }
-    if (isNegative) {
-        digits[0] = charToSegment('-'); // Minus sign
-    }
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)digits[5] << 40);
-    displayVal |= ((uint64_t)digits[4] << 32);
-    displayVal |= ((uint64_t)digits[3] << 24);
-    displayVal |= ((uint64_t)digits[2] << 16);
-    displayVal |= ((uint64_t)digits[1] << 8);
-    displayVal |= ((uint64_t)digits[0] << 0);
-    displayVal |= ((uint64_t)0b10000000 << 8); // Decimal point on digit[1]
-    clockReg.bottomDisplay = displayVal;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    uint8_t digits[SEG_DIGITS];
+    TemperatureGlyphs(averageTemperature, digits);
+    PublishGlyphs(digits);
 }
 
 // Displays averaged humidity on the slider
@@ -470,32 +400,11 @@ void SLIDER_DisplayHumidity_AVG (uint32_t currentHumidity)
         return;
     }
 
-    uint8_t digits[6];
-    for (int i = 0; i < 6; i++) {
-        digits[i] = charToSegment(' '); // Initialize with blank
-    }
-    digits[5] = charToSegment('h');
+    uint8_t digits[SEG_DIGITS];
+    FixedGlyphs(averageHumidity, digits);        // 0.01 %RH
     digits[4] = charToSegment('R');
-    int digitPos = 3;
-    for (int i = 0; i < 4; i++) { // 4 digits for humidity (0-9999)
-        if (averageHumidity > 0 || i > 0) {
-            digits[digitPos - i] = charToSegment('0' + (averageHumidity % 10));
-            averageHumidity /= 10;
-        } else {
-            digits[digitPos - i] = charToSegment('0');
-            averageHumidity /= 10;
-        }
-    }
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)digits[5] << 40);
-    displayVal |= ((uint64_t)digits[4] << 32);
-    displayVal |= ((uint64_t)digits[3] << 24);
-    displayVal |= ((uint64_t)digits[2] << 16);
-    displayVal |= ((uint64_t)digits[1] << 8);
-    displayVal |= ((uint64_t)digits[0] << 0);
-    displayVal |= ((uint64_t)0b10000000 << 8); // Optional decimal point on digit[1]
-    clockReg.bottomDisplay = displayVal;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    digits[5] = charToSegment('h');
+    PublishGlyphs(digits);
 }
 
 // Displays humidity immediately on the slider
@@ -508,30 +417,9 @@ void SLIDER_DisplayHumidity(uint32_t humidity)
     }
     if (humidity > 999999)
         humidity = 999999;
-    uint8_t digits[6];
-    for (int i = 0; i < 6; i++) {
-        digits[i] = charToSegment(' '); // Initialize with blank
-    }
-    digits[5] = charToSegment('h');
+    uint8_t digits[SEG_DIGITS];
+    FixedGlyphs(humidity, digits);        // 0.01 %RH
     digits[4] = charToSegment('R');
-    int digitPos = 3;
-    for (int i = 0; i < 4; i++) { // 4 digits for humidity (0-9999)
-        if (humidity > 0 || i > 0) {
-            digits[digitPos - i] = charToSegment('0' + (humidity % 10));
-            humidity /= 10;
-        } else {
-            digits[digitPos - i] = charToSegment('0');
-            humidity /= 10;
-        }
-    }
-    uint64_t displayVal = 0ULL;
-    displayVal |= ((uint64_t)digits[5] << 40);
-    displayVal |= ((uint64_t)digits[4] << 32);
-    displayVal |= ((uint64_t)digits[3] << 24);
-    displayVal |= ((uint64_t)digits[2] << 16);
-    displayVal |= ((uint64_t)digits[1] << 8);
-    displayVal |= ((uint64_t)digits[0] << 0);
-    displayVal |= ((uint64_t)0b10000000 << 8); // Optional: decimal point on digit[1]
-    clockReg.bottomDisplay = displayVal;
-    // Optionally call UpdateAllDisplays(&clockReg);
+    digits[5] = charToSegment('h');
+    PublishGlyphs(digits);
 }
@@ -0,0 +1,253 @@
+/*
+ * timesync.c
+ *
+ *  RTC discipline from GPS time, see timesync.h
+ */
+
+#include "timesync.h"
+#include "main.h"
+
+#define SECONDS_PER_DAY   86400UL
+#define PPB_PER_PULSE_NUM 1000000000LL   // One CALR pulse = 10^9 / 2^20 ppb
+#define CAL_PULSES_MIN    (-511)
+#define CAL_PULSES_MAX    512
+
+static TSYNC_Stats_t s_stats;
+static TSYNC_LogEntry_t s_log[TSYNC_LOG_SIZE];
+static uint8_t s_logHead = 0;
+static uint8_t s_logCount = 0;
+
+static int32_t  s_shiftTotal = 0;        // Ticks added by SHIFTR since the window started
+static bool     s_windowOpen = false;
+static uint32_t s_windowStart = 0;       // Reference seconds
+static int32_t  s_windowPhase = 0;       // Free-running phase at the start, ticks
+
+static int32_t  s_nmeaOffsets[TSYNC_NMEA_MEDIAN];   // Ring of the last NMEA offsets, ticks
+static uint8_t  s_nmeaCount = 0;
+static uint8_t  s_nmeaNext = 0;
+
+static const uint16_t s_daysBefore[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+// Days since 2000-01-01; the RTC year is 00..99, every 4th one is a leap year
+static uint32_t DaysSince2000(const RTC_DateTypeDef* date)
+{
+    uint32_t y = date->Year;
+    uint32_t days = y * 365U + (y + 3U) / 4U + s_daysBefore[date->Month - 1U] + date->Date - 1U;
+    if (date->Month > 2U && (y % 4U) == 0U) {
+        days++;
+    }
+    return days;
+}
+
+static uint32_t ToSeconds(const RTC_TimeTypeDef* time, const RTC_DateTypeDef* date)
+{
+    return DaysSince2000(date) * SECONDS_PER_DAY
+         + (uint32_t)time->Hours * 3600U + (uint32_t)time->Minutes * 60U + time->Seconds;
+}
+
+static void FromSeconds(uint32_t seconds, RTC_TimeTypeDef* time, RTC_DateTypeDef* date)
+{
+    uint32_t days = seconds / SECONDS_PER_DAY;
+    uint32_t sod = seconds % SECONDS_PER_DAY;
+
+    *time = (RTC_TimeTypeDef){ 0 };
+    time->Hours   = (uint8_t)(sod / 3600U);
+    time->Minutes = (uint8_t)((sod / 60U) % 60U);
+    time->Seconds = (uint8_t)(sod % 60U);
+    time->DayLightSaving = RTC_DAYLIGHTSAVING_NONE;
+    time->StoreOperation = RTC_STOREOPERATION_RESET;
+
+    date->WeekDay = (uint8_t)((days + 5U) % 7U + 1U);    // 2000-01-01 was a Saturday
+    uint32_t y = 0;
+    while (1) {
+        uint32_t len = (y % 4U == 0U) ? 366U : 365U;
+        if (days < len) break;
+        days -= len;
+        y++;
+    }
+    uint8_t m = 12;
+    while (m > 1U) {
+        uint32_t first = s_daysBefore[m - 1U] + ((m > 2U && (y % 4U) == 0U) ? 1U : 0U);
+        if (days >= first) {
+            days -= first;
+            break;
+        }
+        m--;
+    }
+    date->Year  = (uint8_t)y;
+    date->Month = m;
+    date->Date  = (uint8_t)(days + 1U);
+}
+
+static void Log(uint32_t time, TSYNC_Action_t action)
+{
+    s_log[s_logHead] = (TSYNC_LogEntry_t){
+        .time = time,
+        .offsetMs = s_stats.offsetMs,
+        .freqPpb = s_stats.freqPpb,
+        .calPulses = s_stats.calPulses,
+        .action = (uint8_t)action,
+        .source = s_stats.source,
+    };
+    s_logHead = (uint8_t)((s_logHead + 1U) % TSYNC_LOG_SIZE);
+    if (s_logCount < TSYNC_LOG_SIZE) s_logCount++;
+}
+
+// Adds an NMEA offset; false until there are TSYNC_NMEA_MEDIAN of them
+static bool NmeaMedian(int32_t offset, int32_t* median)
+{
+    s_nmeaOffsets[s_nmeaNext] = offset;
+    s_nmeaNext = (uint8_t)((s_nmeaNext + 1U) % TSYNC_NMEA_MEDIAN);
+    if (s_nmeaCount < TSYNC_NMEA_MEDIAN) s_nmeaCount++;
+    if (s_nmeaCount < TSYNC_NMEA_MEDIAN) {
+        return false;
+    }
+
+    int32_t sorted[TSYNC_NMEA_MEDIAN];
+    for (uint8_t i = 0; i < TSYNC_NMEA_MEDIAN; i++) {
+        uint8_t j = i;
+        for (; j > 0U && sorted[j - 1U] > s_nmeaOffsets[i]; j--) {
+            sorted[j] = sorted[j - 1U];
+        }
+        sorted[j] = s_nmeaOffsets[i];
+    }
+    *median = sorted[TSYNC_NMEA_MEDIAN / 2U];
+    return true;
+}
+
+static bool WriteCalibration(int32_t pulses)
+{
+    uint32_t plus = RTC_SMOOTHCALIB_PLUSPULSES_RESET;
+    uint32_t minus = (uint32_t)(-pulses);
+    if (pulses > 0) {
+        plus = RTC_SMOOTHCALIB_PLUSPULSES_SET;  // +512, then take the rest off
+        minus = (uint32_t)(512 - pulses);
+    }
+    return HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC, plus, minus) == HAL_OK;
+}
+
+void TSYNC_Init(void)
+{
+    uint32_t calr = RTC->CALR;
+    int32_t pulses = -(int32_t)(calr & RTC_CALR_CALM);
+    if (calr & RTC_CALR_CALP) pulses += 512;
+    s_stats = (TSYNC_Stats_t){ .calPulses = (int16_t)pulses };
+    s_logHead = 0;
+    s_logCount = 0;
+    s_windowOpen = false;
+    s_nmeaCount = 0;
+}
+
+TSYNC_Action_t TSYNC_Update(const RTC_TimeTypeDef* refTime, const RTC_DateTypeDef* refDate,
+                            uint32_t refTicks, const RTC_Raw_t* rtc, TSYNC_Source_t source)
+{
+    const int32_t prediv = (int32_t)hrtc.Init.SynchPrediv;
+    const uint32_t tps = (uint32_t)prediv + 1U;             // Ticks per second
+
+    RTC_TimeTypeDef rtcTime;
+    RTC_DateTypeDef rtcDate;
+    RTC_RawToTime(rtc, &rtcTime, &rtcDate);
+
+    uint32_t refSec = ToSeconds(refTime, refDate) + refTicks / tps;
+    int32_t refFrac = (int32_t)(refTicks % tps);
+    int32_t rtcFrac = prediv - (int32_t)rtc->ssr;           // Negative right after a SUBFS shift
+    int64_t diff = ((int64_t)refSec - (int64_t)ToSeconds(&rtcTime, &rtcDate)) * (int64_t)tps
+                 + refFrac - rtcFrac;                       // Ticks, +: RTC late
+    int64_t diffMs = (diff * 1000) / (int64_t)tps;
+
+    s_stats.samples++;
+    s_stats.offsetMs = (diffMs > INT32_MAX) ? INT32_MAX : (diffMs < INT32_MIN) ? INT32_MIN : (int32_t)diffMs;
+    s_stats.offsetUs = (diffMs > 1000 || diffMs < -1000) ? 0 : (int32_t)((diff * 1000000) / (int64_t)tps);
+    if (source != s_stats.source) {
+        s_stats.source = (uint8_t)source;
+        s_windowOpen = false;
+        s_nmeaCount = 0;
+    }
+
+    /* Step: far off (first fix, DST change, date). Rounded to the nearest
+       second; the shift takes the rest on the next sample */
+    if (diffMs > TSYNC_STEP_MS || diffMs < -TSYNC_STEP_MS) {
+        RTC_TimeTypeDef t;
+        RTC_DateTypeDef d;
+        FromSeconds(refSec + (((uint32_t)refFrac * 2U >= tps) ? 1U : 0U), &t, &d);
+        HAL_RTC_SetTime(&hrtc, &t, RTC_FORMAT_BIN);
+        HAL_RTC_SetDate(&hrtc, &d, RTC_FORMAT_BIN);
+        s_stats.steps++;
+        s_windowOpen = false;
+        s_nmeaCount = 0;
+        Log(refSec, TSYNC_STEP);
+        return TSYNC_STEP;
+    }
+
+    int32_t offset = (int32_t)diff;                        // Under half a second here
+    int32_t phase = offset + s_shiftTotal;                 // As if never shifted
+    TSYNC_Action_t action = TSYNC_NONE;
+
+    if (!s_windowOpen) {
+        s_windowOpen = true;
+        s_windowStart = refSec;
+        s_windowPhase = offset;
+        s_shiftTotal = 0;
+    } else if (refSec - s_windowStart >= TSYNC_FREQ_WINDOW_S) {
+        uint32_t elapsed = refSec - s_windowStart;
+        int64_t ppb = ((int64_t)(phase - s_windowPhase) * 1000000000LL) / ((int64_t)tps * elapsed);
+        s_stats.freqPpb = (int32_t)ppb;
+
+        /* RTC slow (phase growing): add pulses. Rounded to whole pulses */
+        int64_t scaled = ppb * 1048576LL;
+        int32_t delta = (int32_t)((scaled + (scaled >= 0 ? PPB_PER_PULSE_NUM / 2 : -PPB_PER_PULSE_NUM / 2))
+                                  / PPB_PER_PULSE_NUM);
+        int32_t pulses = s_stats.calPulses + delta;
+        if (pulses < CAL_PULSES_MIN) pulses = CAL_PULSES_MIN;
+        if (pulses > CAL_PULSES_MAX) pulses = CAL_PULSES_MAX;
+        if (pulses != s_stats.calPulses && WriteCalibration(pulses)) {
+            s_stats.calPulses = (int16_t)pulses;
+            s_stats.calibrations++;
+        }
+        action = TSYNC_CALIBRATE;
+        Log(refSec, TSYNC_CALIBRATE);
+
+        /* New window from here, measured with the new calibration */
+        s_windowStart = refSec;
+        s_shiftTotal = 0;
+        s_windowPhase = offset;
+    }
+
+    /* PPS offsets are used as they come; NMEA ones through the median, and
+       not at all until the median has its samples */
+    int32_t correction = offset;
+    bool judge = true;
+    int32_t band = (int32_t)(((int64_t)TSYNC_DEADBAND_PPS_US * tps) / 1000000);
+    if (source == TSYNC_SRC_NMEA) {
+        judge = NmeaMedian(offset, &correction);
+        band = (TSYNC_DEADBAND_MS * (int32_t)tps) / 1000;
+    }
+    if (judge && (correction > band || correction < -band)) {
+        /* ADD1S + SUBFS: forward by 1 s - SUBFS ticks; SUBFS alone: back */
+        HAL_StatusTypeDef st = (correction > 0)
+            ? HAL_RTCEx_SetSynchroShift(&hrtc, RTC_SHIFTADD1S_SET, (uint32_t)((int32_t)tps - correction))
+            : HAL_RTCEx_SetSynchroShift(&hrtc, RTC_SHIFTADD1S_RESET, (uint32_t)(-correction));
+        if (st == HAL_OK) {
+            s_shiftTotal += correction;
+            s_nmeaCount = 0;          // The offsets so far were taken before the shift
+            s_stats.shifts++;
+            Log(refSec, TSYNC_SHIFT);
+            if (action == TSYNC_NONE) action = TSYNC_SHIFT;
+        }
+    }
+    return action;
+}
+
+void TSYNC_GetStats(TSYNC_Stats_t* stats)
+{
+    *stats = s_stats;
+}
+
+bool TSYNC_GetLog(uint8_t age, TSYNC_LogEntry_t* entry)
+{
+    if (age >= s_logCount) {
+        return false;
+    }
+    *entry = s_log[(s_logHead + TSYNC_LOG_SIZE - 1U - age) % TSYNC_LOG_SIZE];
+    return true;
+}
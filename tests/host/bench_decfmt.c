@@ -0,0 +1,170 @@
+/*
+ * bench_decfmt.c
+ *
+ *  Host benchmark: 6-digit 7-seg number rendering, the old %10 / /10 digit
+ *  loops against decfmt. Checks DECFMT_U32/U64 against printf for random
+ *  values, all widths and both paddings, before timing anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "display.h"
+#include "decfmt.h"
+
+#include "build/segtable.inc"
+
+/* ---- Old paths, as they were before decfmt ---- */
+
+// Set7Seg_DisplayLargeNumber(): two 64-bit divisions per digit
+__attribute__((noinline)) static void OldLargeNumber(uint64_t number, uint8_t* backBuffer)
+{
+    for (int i = 5; i >= 0; i--) {
+        if (number > 0) {
+            backBuffer[i] = charToSegment('0' + (number % 10));
+            number /= 10;
+        } else {
+            backBuffer[i] = SEG_BLANK;
+        }
+    }
+}
+
+// SLIDER_DisplayNumber()
+__attribute__((noinline)) static void OldNumber(uint32_t number, uint8_t* digits)
+{
+    for (int i = 5; i >= 0; i--) {
+        digits[i] = charToSegment('0' + (number % 10));
+        number /= 10;
+    }
+}
+
+__attribute__((noinline)) static void NewLargeNumber(uint64_t number, uint8_t* backBuffer)
+{
+    DECFMT_U64(number, backBuffer, SEG_DIGITS, DECFMT_BLANK_PAD);
+}
+
+__attribute__((noinline)) static void NewNumber(uint32_t number, uint8_t* digits)
+{
+    DECFMT_U32(number, digits, SEG_DIGITS, DECFMT_ZERO_PAD);
+}
+
+/* ---- Reference: printf, right-aligned, cut to the lowest 'width' characters ---- */
+static void Reference(const char* text, uint8_t width, uint8_t* glyphs)
+{
+    size_t len = strlen(text);
+    for (uint8_t i = 0; i < width; i++) {
+        glyphs[i] = charToSegment(text[len - width + i]);
+    }
+}
+
+static uint64_t Random64(void)
+{
+    uint64_t v = ((uint64_t)rand() << 62) ^ ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+    return v >> (rand() % 64);
+}
+
+static long Check(void)
+{
+    char text[64];
+    uint8_t want[24], got[24];
+    long bad = 0;
+
+    for (long i = 0; i < 3000000; i++) {
+        uint64_t v = (i < 1000) ? UINT64_MAX - (uint64_t)i : Random64();
+        uint8_t zero = (uint8_t)(rand() & 1);
+        uint8_t w = (uint8_t)(1 + rand() % 20);
+        snprintf(text, sizeof(text), zero ? "%040" PRIu64 : "%40" PRIu64, v);
+        Reference(text, w, want);
+        DECFMT_U64(v, got, w, zero ? DECFMT_ZERO_PAD : DECFMT_BLANK_PAD);
+        if (memcmp(want, got, w) != 0 && bad++ < 5) {
+            printf("FAIL: DECFMT_U64(%" PRIu64 ", width %u, pad %u)\n", v, w, zero);
+        }
+
+        uint32_t v32 = (uint32_t)v;
+        w = (uint8_t)(1 + rand() % 10);
+        snprintf(text, sizeof(text), zero ? "%040" PRIu32 : "%40" PRIu32, v32);
+        Reference(text, w, want);
+        DECFMT_U32(v32, got, w, zero ? DECFMT_ZERO_PAD : DECFMT_BLANK_PAD);
+        if (memcmp(want, got, w) != 0 && bad++ < 5) {
+            printf("FAIL: DECFMT_U32(%" PRIu32 ", width %u, pad %u)\n", v32, w, zero);
+        }
+
+        /* Same glyphs as the old loops (old large number: 0 is a blank field) */
+        OldLargeNumber(v, want);
+        NewLargeNumber(v, got);
+        if (v != 0U && memcmp(want, got, SEG_DIGITS) != 0 && bad++ < 5) {
+            printf("FAIL: large number %" PRIu64 " differs from the old loop\n", v);
+        }
+        OldNumber(v32 % 1000000U, want);
+        NewNumber(v32 % 1000000U, got);
+        if (memcmp(want, got, SEG_DIGITS) != 0 && bad++ < 5) {
+            printf("FAIL: number %" PRIu32 " differs from the old loop\n", v32 % 1000000U);
+        }
+    }
+    return bad;
+}
+
+static double Now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+#define BATCHES  400
+#define CALLS    20000L
+
+static volatile uint8_t s_sink;
+
+typedef struct { double oldNs, newNs; } Pair_t;
+
+/* Old and new path in alternating short batches; the fastest batch of each
+   counts, which filters out preemption and clock changes on a busy host */
+static Pair_t Time64(void (*oldFn)(uint64_t, uint8_t*), void (*newFn)(uint64_t, uint8_t*), uint64_t first)
+{
+    Pair_t best = { 1e9, 1e9 };
+    uint8_t g[SEG_DIGITS];
+    for (int b = 0; b < BATCHES; b++) {
+        double t0 = Now();
+        for (long i = 0; i < CALLS; i++) { oldFn(first + (uint64_t)i, g); s_sink ^= g[0]; }
+        double t1 = Now();
+        for (long i = 0; i < CALLS; i++) { newFn(first + (uint64_t)i, g); s_sink ^= g[0]; }
+        double t2 = Now();
+        if ((t1 - t0) / CALLS * 1e9 < best.oldNs) best.oldNs = (t1 - t0) / CALLS * 1e9;
+        if ((t2 - t1) / CALLS * 1e9 < best.newNs) best.newNs = (t2 - t1) / CALLS * 1e9;
+    }
+    return best;
+}
+
+static Pair_t Time32(void (*oldFn)(uint32_t, uint8_t*), void (*newFn)(uint32_t, uint8_t*), uint32_t first)
+{
+    Pair_t best = { 1e9, 1e9 };
+    uint8_t g[SEG_DIGITS];
+    for (int b = 0; b < BATCHES; b++) {
+        double t0 = Now();
+        for (long i = 0; i < CALLS; i++) { oldFn(first + (uint32_t)i, g); s_sink ^= g[0]; }
+        double t1 = Now();
+        for (long i = 0; i < CALLS; i++) { newFn(first + (uint32_t)i, g); s_sink ^= g[0]; }
+        double t2 = Now();
+        if ((t1 - t0) / CALLS * 1e9 < best.oldNs) best.oldNs = (t1 - t0) / CALLS * 1e9;
+        if ((t2 - t1) / CALLS * 1e9 < best.newNs) best.newNs = (t2 - t1) / CALLS * 1e9;
+    }
+    return best;
+}
+
+int main(void)
+{
+    long bad = Check();
+    Pair_t t;
+
+    t = Time64(OldLargeNumber, NewLargeNumber, 0x0123456789ABCDEFULL);
+    printf("u64 > 32 bits, 6 digits: old %.2f ns, decfmt %.2f ns\n", t.oldNs, t.newNs);
+    t = Time64(OldLargeNumber, NewLargeNumber, 123456U);
+    printf("u64 < 2^32,    6 digits: old %.2f ns, decfmt %.2f ns\n", t.oldNs, t.newNs);
+    t = Time32(OldNumber, NewNumber, 123456U);
+    printf("u32,           6 digits: old %.2f ns, decfmt %.2f ns\n", t.oldNs, t.newNs);
+    printf("%ld mismatches\n", bad);
+    return bad ? 1 : 0;
+}
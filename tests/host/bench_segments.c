@@ -0,0 +1,126 @@
+/*
+ * bench_segments.c
+ *
+ *  Host benchmark: ASCII -> 7-seg glyph lookup, the old charToSegment()
+ *  switch over segmentMap[] against the segmentTable[] lookup in display.h.
+ *  Also checks all 128 characters: the only differences allowed are the
+ *  glyphs the table added on purpose.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "display.h"
+
+/* The real table, cut out of display.c by the Makefile */
+#include "build/segtable.inc"
+
+/* ---- Old path, as it was before the table ---- */
+static const uint8_t segmentMap[42] = {
+    0b00111111,   /* 0 */
+    0b00000110,   /* 1 */
+    0b01011011,   /* 2 */
+    0b01001111,   /* 3 */
+    0b01100110,   /* 4 */
+    0b01101101,   /* 5 */
+    0b01111101,   /* 6 */
+    0b00000111,   /* 7 */
+    0b01111111,   /* 8 */
+    0b01101111,   /* 9 */
+    0b00000000,   /* Blank (10) */
+    0b01000000,   /* Minus (11) */
+    0b01100011,   /* Degree (12) */
+    0b00111001,   /* C (13) */
+    0b01010000,   /* r (14) */
+    0b01110100,   /* h (15) */
+    0b01110001,   /* F (16) */
+    0b01110111,   /* A (17) */
+    0b01111000,   /* t (18) */
+    0b00111110,   /* U/V (19) */
+    0b01010100,   /* n (20) */
+    0b00010000,   /* i (21) */
+    0b01111001,   /* e (22) */
+    0b01011110,   /* d (23) */
+    0b01110011,   /* p (24) */
+    0b01011100,   /* o (25) */
+    0b00011100,   /* u/w/v (26) */
+    0b00111000,   /* L (27) */
+    0b01111100,   /* b (28) */
+    0b01101110,   /* y (29) */
+    0b01110110,   /* H (30) */
+    0b00011110    /* J (31) */
+};
+
+__attribute__((noinline)) static uint8_t OldCharToSegment(char c)
+{
+    switch (c) {
+    case '0' ... '9':           return segmentMap[c - '0'];
+    case '-':                   return segmentMap[11];
+    case '*':                   return segmentMap[12];
+    case 'C':                   return segmentMap[13];
+    case 'c':                   return segmentMap[29];
+    case 'r': case 'R':         return segmentMap[14];
+    case 'h':                   return segmentMap[15];
+    case 's': case 'S':         return segmentMap[5];
+    case 'F':                   return segmentMap[16];
+    case 'A': case 'a':         return segmentMap[17];
+    case 't': case 'T':         return segmentMap[18];
+    case 'V': case 'U': case 'W': return segmentMap[19];
+    case 'n': case 'N':         return segmentMap[20];
+    case 'i':                   return segmentMap[21];
+    case 'E': case 'e':         return segmentMap[22];
+    case 'd':                   return segmentMap[23];
+    case 'P': case 'p':         return segmentMap[24];
+    case 'o':                   return segmentMap[25];
+    case 'O':                   return segmentMap[0];
+    case 'u': case 'w': case 'v': return segmentMap[26];
+    case 'L':                   return segmentMap[27];
+    case 'z': case 'Z':         return segmentMap[2];
+    case 'b': case 'B':         return segmentMap[28];
+    case 'y':                   return segmentMap[29];
+    case 'H':                   return segmentMap[30];
+    case 'j': case 'J':         return segmentMap[31];
+    default:                    return segmentMap[10];
+    }
+}
+
+__attribute__((noinline)) static uint8_t NewCharToSegment(char c)
+{
+    return charToSegment(c);
+}
+
+/* Characters the table maps differently on purpose */
+static const char s_changed[] = "c_=GIqY";
+
+static double Now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    int bad = 0;
+    for (int c = 0; c < 128; c++) {
+        if (OldCharToSegment((char)c) != NewCharToSegment((char)c) && (c == 0 || strchr(s_changed, c) == NULL)) {
+            printf("FAIL: char 0x%02X: switch 0x%02X, table 0x%02X\n", c, OldCharToSegment((char)c), NewCharToSegment((char)c));
+            bad++;
+        }
+    }
+
+    const char* text = "12:34 temp -5*C hum 45rH Menu End abcdefghijklmnopqrstuvwxyz";
+    const size_t len = strlen(text);
+    const long n = 20000000;
+    volatile uint32_t sink = 0;
+
+    double t0 = Now();
+    for (long k = 0; k < n; k++) sink += OldCharToSegment(text[k % len]);
+    double t1 = Now();
+    for (long k = 0; k < n; k++) sink += NewCharToSegment(text[k % len]);
+    double t2 = Now();
+
+    printf("charToSegment: switch %.2f ns/char, table %.2f ns/char\n",
+           (t1 - t0) / n * 1e9, (t2 - t1) / n * 1e9);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * stm32f4xx_hal.h (host stub)
+ *
+ *  Just enough of the HAL for main.h, rtc.h and timesync.c on the host.
+ *  The RTC calls are implemented by the test that links timesync.c.
+ */
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef enum
+{
+  HAL_OK = 0,
+  HAL_ERROR,
+  HAL_BUSY,
+  HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct { int unused; } SPI_HandleTypeDef;
+typedef struct { int unused; } TIM_HandleTypeDef;
+
+typedef struct
+{
+  uint8_t  Hours;
+  uint8_t  Minutes;
+  uint8_t  Seconds;
+  uint8_t  TimeFormat;
+  uint32_t SubSeconds;
+  uint32_t SecondFraction;
+  uint32_t DayLightSaving;
+  uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+  uint8_t WeekDay;
+  uint8_t Month;
+  uint8_t Date;
+  uint8_t Year;
+} RTC_DateTypeDef;
+
+typedef struct
+{
+  uint32_t AsynchPrediv;
+  uint32_t SynchPrediv;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+  RTC_InitTypeDef Init;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t CALR;
+} RTC_TypeDef;
+
+extern RTC_TypeDef host_rtc;
+#define RTC                              (&host_rtc)
+
+#define RTC_CALR_CALP                    0x00008000U
+#define RTC_CALR_CALM                    0x000001FFU
+
+#define RTC_FORMAT_BIN                   0U
+#define RTC_DAYLIGHTSAVING_NONE          0U
+#define RTC_STOREOPERATION_RESET         0U
+#define RTC_SHIFTADD1S_RESET             0U
+#define RTC_SHIFTADD1S_SET               0x80000000U
+#define RTC_SMOOTHCALIB_PERIOD_32SEC     0U
+#define RTC_SMOOTHCALIB_PLUSPULSES_RESET 0U
+#define RTC_SMOOTHCALIB_PLUSPULSES_SET   RTC_CALR_CALP
+
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef* hrtc, RTC_TimeTypeDef* sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef* hrtc, RTC_DateTypeDef* sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef* hrtc, uint32_t ShiftAdd1S, uint32_t ShiftSubFS);
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef* hrtc, uint32_t SmoothCalibPeriod,
+                                           uint32_t SmoothCalibPlusPulses, uint32_t SmoothCalibMinusPulsesValue);
+
+#endif /* HOST_STM32F4XX_HAL_H_ */
@@ -0,0 +1,333 @@
+/*
+ * test_pps_tsync.c
+ *
+ *  Host test: PPS edge tracking (pps.c) fed with simulated TIM2 captures,
+ *  and the RTC discipline (timesync.c) against a simulated RTC behind the
+ *  stub HAL (stub/stm32f4xx_hal.h): step, shift, NMEA median and CALR.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "pps.h"
+#include "timesync.h"
+
+static int s_failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_failures++; } } while (0)
+
+/* ---- PPS ---- */
+
+// Timer near the 32-bit wrap, so every test also crosses it
+#define T0  (0xFFFFFFFFUL - 2500000UL)
+
+static uint32_t Edge(uint32_t n)
+{
+    return (uint32_t)(T0 + n * PPS_PERIOD_US);
+}
+
+static void TestPpsLock(void)
+{
+    uint32_t edge = 0;
+    PPS_Init();
+
+    /* Edges 0..2 give two periods: not locked yet */
+    for (uint32_t n = 0; n < PPS_LOCK_EDGES; n++) {
+        PPS_Capture(Edge(n) + ((n & 1U) ? 40U : 0U));       // Jitter well inside the tolerance
+        CHECK(!PPS_Associate(Edge(n) + 300000U, &edge));
+    }
+    /* The third good period locks */
+    PPS_Capture(Edge(PPS_LOCK_EDGES));
+    CHECK(PPS_Associate(Edge(PPS_LOCK_EDGES) + 300000U, &edge));
+    CHECK(edge == Edge(PPS_LOCK_EDGES));
+
+    PPS_Stats_t stats;
+    PPS_GetStats(&stats);
+    CHECK(stats.locks == 1U);
+    CHECK(stats.glitches == 0U);
+    CHECK(stats.nmeaDelayLastUs == 300000U);
+}
+
+static void TestPpsAssociate(void)
+{
+    uint32_t edge = 0;
+    PPS_Init();
+    for (uint32_t n = 0; n <= 4U; n++) PPS_Capture(Edge(n));
+
+    /* Sentence ended after edge 4 */
+    CHECK(PPS_Associate(Edge(4) + 150000U, &edge) && edge == Edge(4));
+    /* Edge 5 came between the end of the sentence and the parse: still edge 4 */
+    PPS_Capture(Edge(5));
+    CHECK(PPS_Associate(Edge(4) + 400000U, &edge) && edge == Edge(4));
+    /* Too long after its edge to name it */
+    CHECK(!PPS_Associate(Edge(5) + PPS_NMEA_MAX_US + 1000U, &edge));
+    /* No edge for longer than the timeout */
+    CHECK(!PPS_Associate(Edge(5) + PPS_TIMEOUT_US + 1000U, &edge));
+}
+
+static void TestPpsLoss(void)
+{
+    uint32_t edge = 0;
+    PPS_Init();
+    uint32_t n = 0;
+    for (; n <= PPS_LOCK_EDGES; n++) PPS_Capture(Edge(n));
+    CHECK(PPS_Associate(Edge(n - 1U) + 100000U, &edge));
+
+    /* Missed edge: a 2 s period drops the lock */
+    n++;
+    PPS_Capture(Edge(n));
+    CHECK(!PPS_Associate(Edge(n) + 100000U, &edge));
+
+    /* Three good periods lock again */
+    for (uint32_t k = 1; k <= PPS_LOCK_EDGES; k++) {
+        CHECK(!PPS_Associate(Edge(n) + 100000U, &edge));
+        PPS_Capture(Edge(++n));
+    }
+    CHECK(PPS_Associate(Edge(n) + 100000U, &edge) && edge == Edge(n));
+
+    /* Out-of-band edge: a period just over the tolerance drops it too */
+    n++;
+    PPS_Capture(Edge(n) + PPS_TOLERANCE_US + 1U);
+    CHECK(!PPS_Associate(Edge(n) + 100000U, &edge));
+
+    PPS_Stats_t stats;
+    PPS_GetStats(&stats);
+    CHECK(stats.locks == 2U);
+    CHECK(stats.glitches == 2U);
+}
+
+/* ---- Simulated RTC behind the stub HAL ---- */
+
+#define PREDIV     8191U
+#define TPS        (PREDIV + 1U)
+#define DAY0       9132UL             // 2025-01-01, days since 2000-01-01
+
+RTC_HandleTypeDef hrtc = { .Init = { .AsynchPrediv = 3U, .SynchPrediv = PREDIV } };
+RTC_TypeDef host_rtc;
+
+static double  s_true;                // True local time, s since 2000
+static double  s_rtc;                 // RTC reading at s_true, ticks
+static double  s_drift;               // LSE error without calibration, +: fast
+static int32_t s_pulses;              // CALR in pulses per 2^20
+static RTC_TimeTypeDef s_setTime;
+static uint32_t s_sets, s_shifts, s_calibs;
+static int32_t  s_lastShift;          // Ticks, +: RTC moved forward
+
+static double Rate(void)
+{
+    return 1.0 + s_drift + (double)s_pulses / 1048576.0;
+}
+
+static void Advance(double to)
+{
+    s_rtc += (to - s_true) * TPS * Rate();
+    s_true = to;
+}
+
+static uint8_t Bcd(uint32_t v)
+{
+    return (uint8_t)(((v / 10U) << 4) | (v % 10U));
+}
+
+static uint8_t Bin(uint32_t v)
+{
+    return (uint8_t)((v >> 4) * 10U + (v & 0x0FU));
+}
+
+static void Snapshot(RTC_Raw_t* raw)
+{
+    uint64_t ticks = (uint64_t)floor(s_rtc);
+    uint32_t sod = (uint32_t)((ticks / TPS) % 86400U);
+    raw->tr = ((uint32_t)Bcd(sod / 3600U) << 16) | ((uint32_t)Bcd((sod / 60U) % 60U) << 8) | Bcd(sod % 60U);
+    raw->dr = ((uint32_t)Bcd(25U) << 16) | (1U << 13) | ((uint32_t)Bcd(1U) << 8) | Bcd(1U);
+    raw->ssr = PREDIV - (uint32_t)(ticks % TPS);
+}
+
+void RTC_RawToTime(const RTC_Raw_t* raw, RTC_TimeTypeDef* time, RTC_DateTypeDef* date)
+{
+    *time = (RTC_TimeTypeDef){ 0 };
+    time->Hours = Bin((raw->tr >> 16) & 0x3FU);
+    time->Minutes = Bin((raw->tr >> 8) & 0x7FU);
+    time->Seconds = Bin(raw->tr & 0x7FU);
+    time->SubSeconds = raw->ssr;
+    date->Year = Bin((raw->dr >> 16) & 0xFFU);
+    date->WeekDay = (uint8_t)((raw->dr >> 13) & 7U);
+    date->Month = Bin((raw->dr >> 8) & 0x1FU);
+    date->Date = Bin(raw->dr & 0x3FU);
+}
+
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef* h, RTC_TimeTypeDef* t, uint32_t format)
+{
+    (void)h; (void)format;
+    s_setTime = *t;
+    return HAL_OK;
+}
+
+// Applies the time set just before; the prescalers restart at the write
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef* h, RTC_DateTypeDef* d, uint32_t format)
+{
+    (void)h; (void)format;
+    CHECK(d->Year == 25U && d->Month == 1U && d->Date == 1U);
+    s_rtc = ((double)DAY0 * 86400.0 + s_setTime.Hours * 3600.0 + s_setTime.Minutes * 60.0
+             + s_setTime.Seconds) * TPS;
+    s_sets++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef* h, uint32_t add1s, uint32_t subfs)
+{
+    (void)h;
+    CHECK(subfs <= PREDIV);
+    s_lastShift = ((add1s == RTC_SHIFTADD1S_SET) ? (int32_t)TPS : 0) - (int32_t)subfs;
+    s_rtc += s_lastShift;
+    s_shifts++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef* h, uint32_t period, uint32_t plus, uint32_t minus)
+{
+    (void)h; (void)period;
+    CHECK(minus <= RTC_CALR_CALM);
+    s_pulses = ((plus == RTC_SMOOTHCALIB_PLUSPULSES_SET) ? 512 : 0) - (int32_t)minus;
+    host_rtc.CALR = plus | minus;
+    s_calibs++;
+    return HAL_OK;
+}
+
+static void SimStart(double rtcAheadS, double drift)
+{
+    s_true = (double)DAY0 * 86400.0 + 3600.0;
+    s_rtc = (s_true + rtcAheadS) * TPS;
+    s_drift = drift;
+    s_pulses = 0;
+    host_rtc.CALR = 0;
+    s_sets = s_shifts = s_calibs = 0;
+    TSYNC_Init();
+}
+
+/* GPS sample for true second 'sec' (since the start of the day), taken
+   'delayS' after its edge; the reference claims 'claimS' (NMEA error) */
+static TSYNC_Action_t Sample(uint32_t sec, double delayS, double claimS, TSYNC_Source_t source)
+{
+    Advance((double)DAY0 * 86400.0 + sec + delayS);
+    RTC_Raw_t raw;
+    Snapshot(&raw);
+    RTC_TimeTypeDef t = { .Hours = (uint8_t)(sec / 3600U), .Minutes = (uint8_t)((sec / 60U) % 60U),
+                          .Seconds = (uint8_t)(sec % 60U) };
+    RTC_DateTypeDef d = { .WeekDay = 3U, .Month = 1U, .Date = 1U, .Year = 25U };
+    return TSYNC_Update(&t, &d, (uint32_t)lround(claimS * TPS), &raw, source);
+}
+
+static void TestStepThenShift(void)
+{
+    SimStart(5.0, 0.0);
+    CHECK(Sample(3601U, 0.2, 0.2, TSYNC_SRC_PPS) == TSYNC_STEP);
+    CHECK(s_sets == 1U);
+    /* The calendar was written 0.2 s into the second: the shift takes that */
+    CHECK(Sample(3602U, 0.2, 0.2, TSYNC_SRC_PPS) == TSYNC_SHIFT);
+    CHECK(abs(s_lastShift - (int32_t)(0.2 * TPS)) <= 1);
+    CHECK(Sample(3603U, 0.2, 0.2, TSYNC_SRC_PPS) == TSYNC_NONE);
+
+    TSYNC_Stats_t stats;
+    TSYNC_GetStats(&stats);
+    CHECK(abs(stats.offsetUs) <= TSYNC_DEADBAND_PPS_US);
+    CHECK(stats.steps == 1U && stats.shifts == 1U);
+}
+
+static void TestPpsDeadband(void)
+{
+    SimStart(0.0, 0.0);
+    /* 300 us late: inside the PPS band */
+    s_rtc -= 0.0003 * TPS;
+    CHECK(Sample(3601U, 0.1, 0.1, TSYNC_SRC_PPS) == TSYNC_NONE);
+    /* 2 ms late: shifted forward at once */
+    s_rtc -= 0.0017 * TPS;
+    CHECK(Sample(3602U, 0.1, 0.1, TSYNC_SRC_PPS) == TSYNC_SHIFT);
+    CHECK(s_lastShift > 0 && abs(s_lastShift - (int32_t)(0.002 * TPS)) <= 1);
+    /* 2 ms early: back */
+    s_rtc += 0.002 * TPS;
+    CHECK(Sample(3603U, 0.1, 0.1, TSYNC_SRC_PPS) == TSYNC_SHIFT);
+    CHECK(s_lastShift < 0 && abs(s_lastShift + (int32_t)(0.002 * TPS)) <= 1);
+}
+
+static void TestNmeaMedian(void)
+{
+    uint32_t sec = 3601U;
+    SimStart(0.0, 0.0);
+    for (uint32_t i = 0; i < TSYNC_NMEA_MEDIAN; i++) {
+        CHECK(Sample(sec++, 0.15, 0.15, TSYNC_SRC_NMEA) == TSYNC_NONE);
+    }
+    /* One sentence 60 ms late: the median does not move */
+    CHECK(Sample(sec++, 0.21, 0.15, TSYNC_SRC_NMEA) == TSYNC_NONE);
+    CHECK(s_shifts == 0U);
+
+    /* The RTC really 40 ms late: shifted once the median sees it */
+    s_rtc -= 0.04 * TPS;
+    uint32_t late = 0;
+    while (s_shifts == 0U && late < TSYNC_NMEA_MEDIAN) {
+        TSYNC_Action_t action = Sample(sec++, 0.15, 0.15, TSYNC_SRC_NMEA);
+        late++;
+        CHECK(action == ((s_shifts != 0U) ? TSYNC_SHIFT : TSYNC_NONE));
+    }
+    CHECK(s_shifts == 1U && late > 1U);
+    CHECK(abs(s_lastShift - (int32_t)(0.04 * TPS)) <= 1);
+
+    /* The offsets taken before the shift are gone: nothing more to do */
+    for (uint32_t i = 0; i < 2U * TSYNC_NMEA_MEDIAN; i++) {
+        CHECK(Sample(sec++, 0.15, 0.15, TSYNC_SRC_NMEA) == TSYNC_NONE);
+    }
+    CHECK(s_shifts == 1U);
+}
+
+static void TestCalibration(void)
+{
+    const double drift = -20e-6;      // LSE 20 ppm slow
+    uint32_t sec = 3601U;
+    uint32_t calibrateAt = 0;
+    SimStart(0.0, drift);
+
+    for (uint32_t i = 0; i <= TSYNC_FREQ_WINDOW_S; i++, sec++) {
+        if (Sample(sec, 0.2, 0.2, TSYNC_SRC_PPS) == TSYNC_CALIBRATE) calibrateAt = i;
+    }
+    TSYNC_Stats_t stats;
+    TSYNC_GetStats(&stats);
+    CHECK(calibrateAt == TSYNC_FREQ_WINDOW_S);
+    CHECK(s_calibs == 1U);
+    CHECK(abs(stats.freqPpb - 20000) <= 500);
+    CHECK(s_pulses == (int32_t)lround(-drift * 1048576.0));
+    /* Meanwhile the phase was held in the band by shifts */
+    CHECK(stats.shifts > 0U);
+    CHECK(abs(stats.offsetUs) <= TSYNC_DEADBAND_PPS_US + 1000000 / (int32_t)TPS);
+
+    /* Calibrated: the next window finds (almost) nothing, no more shifts */
+    uint32_t shifts = stats.shifts;
+    for (uint32_t i = 0; i < TSYNC_FREQ_WINDOW_S; i++, sec++) {
+        Sample(sec, 0.2, 0.2, TSYNC_SRC_PPS);
+    }
+    TSYNC_GetStats(&stats);
+    CHECK(stats.calibrations == 1U);
+    CHECK(abs(stats.freqPpb) <= 1000);
+    CHECK(stats.shifts == shifts);
+
+    TSYNC_LogEntry_t entry;
+    CHECK(TSYNC_GetLog(0, &entry) && entry.action == TSYNC_CALIBRATE);
+}
+
+int main(void)
+{
+    TestPpsLock();
+    TestPpsAssociate();
+    TestPpsLoss();
+    TestStepThenShift();
+    TestPpsDeadband();
+    TestNmeaMedian();
+    TestCalibration();
+
+    if (s_failures != 0) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("pps / timesync: all checks passed\n");
+    return 0;
+}